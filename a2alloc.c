@@ -0,0 +1,462 @@
+/**************************************************************
+ *
+ *                     a2alloc.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of the A2 allocators. The pool keeps one
+ *              free list per power of two, threaded through the freed
+ *              buffers themselves, so recycling an image-sized buffer costs
+ *              two pointer moves and its pages stay faulted in. The arena
+ *              bumps a pointer through chunks got from its parent, so the
+ *              thousands of blocks of a blocked array cost no malloc each.
+ *              The allocator in use is kept per thread, so threads with
+ *              pools of their own never share a lock.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+
+#include "assert.h"
+#include "a2alloc.h"
+
+#define T A2Alloc_T
+
+#define LINE 64         /* alignment of every allocation, a cache line */
+#define SMALLEST 6      /* the smallest pool class holds 2^6 = LINE bytes */
+#define CLASSES 64      /* pool classes, one per bit of a size_t */
+
+/*
+ * A pool: the freed buffers of class k, each 2^k bytes, are a list linked
+ * through their first word.
+ */
+struct pool {
+        struct T methods;       /* must be first */
+        void *lists[CLASSES];
+        size_t reused;          /* allocations served from a list */
+        size_t fresh;           /* allocations that needed new memory */
+        size_t held;            /* bytes on the lists */
+};
+
+/*
+ * One chunk of an arena. Allocations follow the header, which takes a
+ * whole LINE so they stay aligned.
+ */
+struct chunk {
+        struct chunk *next;     /* the chunk filled before this one */
+        size_t bytes;           /* bytes in the chunk, header included */
+};
+
+/*
+ * An arena: allocations are cut from the front of the newest chunk.
+ */
+struct arena {
+        struct T methods;       /* must be first */
+        T parent;               /* where chunks come from and go back to */
+        size_t chunkBytes;      /* the least bytes in a new chunk */
+        struct chunk *chunks;   /* the newest chunk, NULL if none */
+        size_t used;            /* bytes of the newest chunk handed out,
+                                 * header included */
+        size_t served;          /* allocations since the last reset */
+        size_t count;           /* chunks held */
+};
+
+/********** mallocAlloc ********
+ *
+ * Allocates memory with posix_memalign
+ *
+ * Parameters:
+ *      T allocator:            A2Alloc_malloc
+ *      size_t bytes:           the number of bytes
+ *
+ * Return: the memory, aligned to LINE
+ *
+ * Notes:
+ *      - Calls CRE if the memory cannot be allocated
+ *
+ ************************/
+static void *mallocAlloc(T allocator, size_t bytes)
+{
+        (void) allocator;
+        void *p = NULL;
+        int failed = posix_memalign(&p, LINE, bytes > 0 ? bytes : 1);
+        assert(failed == 0);
+        (void) failed;
+        return p;
+}
+
+/********** mallocFree ********
+ *
+ * Frees memory allocated by mallocAlloc
+ *
+ * Parameters:
+ *      T allocator:            A2Alloc_malloc
+ *      void *p:                the memory, or NULL
+ *      size_t bytes:           its size, unused
+ *
+ * Return: n/a
+ *
+ ************************/
+static void mallocFree(T allocator, void *p, size_t bytes)
+{
+        (void) allocator;
+        (void) bytes;
+        free(p);
+}
+
+static struct T mallocMethods = { mallocAlloc, mallocFree };
+T A2Alloc_malloc = &mallocMethods;
+
+/* the allocator of the calling thread, NULL for A2Alloc_malloc */
+static __thread T current = NULL;
+
+/********** sizeClass ********
+ *
+ * Finds the pool class of an allocation
+ *
+ * Parameters:
+ *      size_t bytes:           the size of the allocation
+ *
+ * Return: the least k, at least SMALLEST, with 2^k >= bytes
+ *
+ ************************/
+static int sizeClass(size_t bytes)
+{
+        int k = SMALLEST;
+        while (k < CLASSES - 1 && ((size_t) 1 << k) < bytes) {
+                k++;
+        }
+        return k;
+}
+
+/********** poolAlloc ********
+ *
+ * Hands out a buffer of the class of bytes, a freed one if there is one
+ *
+ * Parameters:
+ *      T allocator:            the pool
+ *      size_t bytes:           the number of bytes
+ *
+ * Return: the buffer, aligned to LINE
+ *
+ * Notes:
+ *      - Calls CRE if new memory is needed and cannot be allocated
+ *
+ ************************/
+static void *poolAlloc(T allocator, size_t bytes)
+{
+        struct pool *pool = (struct pool *) allocator;
+        int k = sizeClass(bytes);
+        void *p = pool->lists[k];
+
+        if (p != NULL) {
+                pool->lists[k] = *(void **) p;
+                pool->held -= (size_t) 1 << k;
+                pool->reused++;
+                return p;
+        }
+        pool->fresh++;
+        return mallocAlloc(A2Alloc_malloc, (size_t) 1 << k);
+}
+
+/********** poolFree ********
+ *
+ * Puts a buffer on the list of its class
+ *
+ * Parameters:
+ *      T allocator:            the pool
+ *      void *p:                the buffer, or NULL
+ *      size_t bytes:           the number of bytes it was allocated with
+ *
+ * Return: n/a
+ *
+ ************************/
+static void poolFree(T allocator, void *p, size_t bytes)
+{
+        struct pool *pool = (struct pool *) allocator;
+        if (p == NULL) {
+                return;
+        }
+        int k = sizeClass(bytes);
+        *(void **) p = pool->lists[k];
+        pool->lists[k] = p;
+        pool->held += (size_t) 1 << k;
+}
+
+/********** A2Alloc_pool_new ********
+ *
+ * Creates an empty pool
+ *
+ * Parameters: none
+ *
+ * Return: the pool
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - Buffers are rounded up to a power of two, so a pool serves images
+ *      of any similar size from the same lists; pages past the end of the
+ *      image are never touched and so never faulted in
+ *      - User is responsible for calling A2Alloc_pool_free once nothing
+ *      allocated from the pool is in use
+ *
+ ************************/
+T A2Alloc_pool_new(void)
+{
+        struct pool *pool = calloc(1, sizeof(*pool));
+        assert(pool != NULL);
+        pool->methods.alloc = poolAlloc;
+        pool->methods.free = poolFree;
+        return &pool->methods;
+}
+
+/********** A2Alloc_pool_free ********
+ *
+ * Frees a pool and the buffers on its lists
+ *
+ * Parameters:
+ *      T *pool:                the pool, set to NULL
+ *
+ * Return: n/a
+ *
+ * Expects: pool and *pool to not be NULL, *pool to be a pool
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Buffers still in use when the pool is freed are leaked
+ *
+ ************************/
+void A2Alloc_pool_free(T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+        assert((*pool)->alloc == poolAlloc);
+        struct pool *p = (struct pool *) *pool;
+
+        for (int k = 0; k < CLASSES; k++) {
+                while (p->lists[k] != NULL) {
+                        void *next = *(void **) p->lists[k];
+                        free(p->lists[k]);
+                        p->lists[k] = next;
+                }
+        }
+        if (current == *pool) {
+                current = NULL;
+        }
+        free(p);
+        *pool = NULL;
+}
+
+/********** arenaAlloc ********
+ *
+ * Cuts an allocation from the newest chunk, getting a new chunk from the
+ * parent if it does not fit
+ *
+ * Parameters:
+ *      T allocator:            the arena
+ *      size_t bytes:           the number of bytes
+ *
+ * Return: the memory, aligned to LINE
+ *
+ * Notes:
+ *      - Calls CRE if the parent cannot allocate a chunk
+ *
+ ************************/
+static void *arenaAlloc(T allocator, size_t bytes)
+{
+        struct arena *arena = (struct arena *) allocator;
+        size_t rounded = (bytes + LINE - 1) / LINE * LINE;
+        rounded = rounded > 0 ? rounded : LINE;
+
+        if (arena->chunks == NULL ||
+            arena->used + rounded > arena->chunks->bytes) {
+                size_t need = rounded + LINE;
+                size_t take = need > arena->chunkBytes ? need
+                                                       : arena->chunkBytes;
+                struct chunk *chunk = arena->parent->alloc(arena->parent,
+                                                           take);
+                chunk->next = arena->chunks;
+                chunk->bytes = take;
+                arena->chunks = chunk;
+                arena->used = LINE;
+                arena->count++;
+        }
+
+        char *p = (char *) arena->chunks + arena->used;
+        arena->used += rounded;
+        arena->served++;
+        return p;
+}
+
+/********** arenaFree ********
+ *
+ * Does nothing: arena memory is given back by A2Alloc_arena_reset
+ *
+ ************************/
+static void arenaFree(T allocator, void *p, size_t bytes)
+{
+        (void) allocator;
+        (void) p;
+        (void) bytes;
+}
+
+/********** A2Alloc_arena_new ********
+ *
+ * Creates an arena holding no chunks
+ *
+ * Parameters:
+ *      T parent:               where chunks come from, e.g. a pool so that
+ *                              the chunks of one image serve the next
+ *      size_t chunk:           the least bytes got from parent at a time
+ *
+ * Return: the arena
+ *
+ * Expects: parent to not be NULL and chunk to be positive
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *      be allocated
+ *      - Allocations larger than chunk get a chunk of their own
+ *      - User is responsible for calling A2Alloc_arena_free
+ *
+ ************************/
+T A2Alloc_arena_new(T parent, size_t chunk)
+{
+        assert(parent != NULL);
+        assert(chunk > 0);
+        struct arena *arena = calloc(1, sizeof(*arena));
+        assert(arena != NULL);
+        arena->methods.alloc = arenaAlloc;
+        arena->methods.free = arenaFree;
+        arena->parent = parent;
+        arena->chunkBytes = chunk;
+        return &arena->methods;
+}
+
+/********** A2Alloc_arena_reset ********
+ *
+ * Gives every chunk of an arena back to its parent, ending the lives of all
+ * the allocations made from it
+ *
+ * Parameters:
+ *      T arena:                the arena
+ *
+ * Return: n/a
+ *
+ * Expects: arena to not be NULL and to be an arena
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Arrays allocated from the arena must be freed (which frees nothing
+ *      of theirs in the arena) before it is reset
+ *
+ ************************/
+void A2Alloc_arena_reset(T arena)
+{
+        assert(arena != NULL && arena->alloc == arenaAlloc);
+        struct arena *a = (struct arena *) arena;
+
+        while (a->chunks != NULL) {
+                struct chunk *next = a->chunks->next;
+                a->parent->free(a->parent, a->chunks, a->chunks->bytes);
+                a->chunks = next;
+        }
+        a->used = 0;
+        a->served = 0;
+        a->count = 0;
+}
+
+/********** A2Alloc_arena_free ********
+ *
+ * Resets an arena and frees it
+ *
+ * Parameters:
+ *      T *arena:               the arena, set to NULL
+ *
+ * Return: n/a
+ *
+ * Expects: arena and *arena to not be NULL, *arena to be an arena
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Alloc_arena_free(T *arena)
+{
+        assert(arena != NULL);
+        A2Alloc_arena_reset(*arena);
+        if (current == *arena) {
+                current = NULL;
+        }
+        free(*arena);
+        *arena = NULL;
+}
+
+/********** A2Alloc_use ********
+ *
+ * Sets the allocator the calling thread's new arrays and transform buffers
+ * come from
+ *
+ * Parameters:
+ *      T allocator:            the allocator, NULL for A2Alloc_malloc
+ *
+ * Return: n/a
+ *
+ ************************/
+void A2Alloc_use(T allocator)
+{
+        current = allocator == A2Alloc_malloc ? NULL : allocator;
+}
+
+/********** A2Alloc_current ********
+ *
+ * Gets the allocator of the calling thread
+ *
+ * Parameters: none
+ *
+ * Return: the allocator last given to A2Alloc_use by this thread, or
+ *         A2Alloc_malloc
+ *
+ ************************/
+T A2Alloc_current(void)
+{
+        return current != NULL ? current : A2Alloc_malloc;
+}
+
+/********** A2Alloc_print ********
+ *
+ * Prints how many allocations an allocator has served and how
+ *
+ * Parameters:
+ *      T allocator:            a pool, an arena or A2Alloc_malloc
+ *      FILE *fp:               where to print
+ *
+ * Return: n/a
+ *
+ * Expects: allocator and fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Other allocators are only named
+ *
+ ************************/
+void A2Alloc_print(T allocator, FILE *fp)
+{
+        assert(allocator != NULL && fp != NULL);
+
+        if (allocator->alloc == poolAlloc) {
+                struct pool *pool = (struct pool *) allocator;
+                fprintf(fp, "pool: %zu reused, %zu fresh, %zu bytes held\n",
+                        pool->reused, pool->fresh, pool->held);
+        } else if (allocator->alloc == arenaAlloc) {
+                struct arena *arena = (struct arena *) allocator;
+                fprintf(fp, "arena: %zu allocations from %zu chunks\n",
+                        arena->served, arena->count);
+        } else if (allocator == A2Alloc_malloc) {
+                fprintf(fp, "malloc\n");
+        } else {
+                fprintf(fp, "client allocator\n");
+        }
+}
+
+#undef T
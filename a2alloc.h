@@ -0,0 +1,60 @@
+/**************************************************************
+ *
+ *                     a2alloc.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for the allocators the A2 arrays get their
+ *              elements from. An allocator is a pair of functions, like an
+ *              A2Methods suite; besides malloc there is a pool that keeps
+ *              freed buffers by size class for the next image, and a bump
+ *              arena that hands out memory from large chunks and gives it
+ *              all back at once. Each thread chooses the allocator its new
+ *              arrays and transform buffers use.
+ *
+ **************************************************************/
+
+#ifndef A2ALLOC_INCLUDED
+#define A2ALLOC_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define T A2Alloc_T
+typedef struct T *T;
+
+/* alloc returns bytes of memory aligned to a cache line (64 bytes), with
+ * contents undefined, and raises a CRE if it cannot; free is given the same
+ * number of bytes back, so allocators need no header of their own. An
+ * allocator is made for one thread at a time. */
+struct T {
+        void *(*alloc)(T allocator, size_t bytes);
+        void  (*free) (T allocator, void *p, size_t bytes);
+};
+
+/* posix_memalign and free, the allocator of every thread to begin with */
+extern T    A2Alloc_malloc;
+
+/* a pool: a freed buffer is kept on the list of its size class (a power of
+ * two) and handed out again by the next alloc of that class */
+extern T    A2Alloc_pool_new (void);
+extern void A2Alloc_pool_free(T *pool);
+
+/* an arena: memory is cut from chunks of at least chunk bytes got from
+ * parent, free does nothing, and reset gives every chunk back to parent */
+extern T    A2Alloc_arena_new  (T parent, size_t chunk);
+extern void A2Alloc_arena_reset(T arena);
+extern void A2Alloc_arena_free (T *arena);
+
+/* the allocator of the calling thread; arrays keep the allocator they were
+ * made with, which must outlive them */
+extern void A2Alloc_use    (T allocator);
+extern T    A2Alloc_current(void);
+
+/* print how many allocations a pool or arena has served and from where */
+extern void A2Alloc_print(T allocator, FILE *fp);
+
+#undef T
+#endif
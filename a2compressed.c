@@ -0,0 +1,113 @@
+/**************************************************************
+ *
+ *                     a2compressed.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: A subclass for A2Methods_T virtual class backed by compressed
+ *              blocked arrays, so every A2 client (the transforms, ppmio,
+ *              a2pack) can keep big images compressed. Arrays are made with
+ *              blocks of at most 64KB, as by the blocked suite, and a cache
+ *              of A2_COMPRESSED_CACHE blocks.
+ *
+ **************************************************************/
+
+#include "a2compressed.h"
+#include "uarray2bz.h"
+
+typedef A2Methods_UArray2 A2;   /* private abbreviation */
+
+static A2 new(int width, int height, int size)
+{
+        return UArray2bz_new_64K_block(width, height, size,
+                                       A2_COMPRESSED_CACHE);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+        return UArray2bz_new(width, height, size, blocksize,
+                             A2_COMPRESSED_CACHE);
+}
+
+static void a2free(A2 *array2p)
+{
+        UArray2bz_free((UArray2bz_T *) array2p);
+}
+
+static int width(A2 array2)
+{
+        return UArray2bz_width(array2);
+}
+
+static int height(A2 array2)
+{
+        return UArray2bz_height(array2);
+}
+
+static int size(A2 array2)
+{
+        return UArray2bz_size(array2);
+}
+
+static int blocksize(A2 array2)
+{
+        return UArray2bz_blocksize(array2);
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+        return UArray2bz_at(array2, i, j);
+}
+
+typedef void applyfun(int i, int j, UArray2bz_T array2bz, void *elem,
+                      void *cl);
+
+static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        UArray2bz_map(array2, (applyfun *) apply, cl);
+}
+
+struct small_closure {
+        A2Methods_smallapplyfun *apply;
+        void *cl;
+};
+
+static void apply_small(int i, int j, UArray2bz_T array2, void *elem,
+                        void *vcl)
+{
+        struct small_closure *cl = vcl;
+        (void) i;
+        (void) j;
+        (void) array2;
+        cl->apply(elem, cl->cl);
+}
+
+static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply,
+                                  void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2bz_map(a2, apply_small, &mycl);
+}
+
+static struct A2Methods_T uarray2_methods_compressed_struct = {
+        new,
+        new_with_blocksize,
+        a2free,
+        width,
+        height,
+        size,
+        blocksize,
+        at,
+        NULL,                   /* map_row_major */
+        NULL,                   /* map_col_major */
+        map_block_major,
+        map_block_major,        /* map_default */
+        NULL,                   /* small_map_row_major */
+        NULL,                   /* small_map_col_major */
+        small_map_block_major,
+        small_map_block_major,  /* small_map_default */
+};
+
+A2Methods_T uarray2_methods_compressed = &uarray2_methods_compressed_struct;
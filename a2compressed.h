@@ -0,0 +1,35 @@
+/**************************************************************
+ *
+ *                     a2compressed.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The A2Methods suite for compressed blocked arrays
+ *              (uarray2bz.h). It supports block-major mapping only, like the
+ *              blocked suite.
+ *
+ **************************************************************/
+
+#ifndef A2COMPRESSED_INCLUDED
+#define A2COMPRESSED_INCLUDED
+
+#include "a2methods.h"
+
+/* blocks each array made by this suite keeps decompressed */
+#define A2_COMPRESSED_CACHE 16
+
+/*
+ * Unlike the other suites, a pointer from at is only good until the next
+ * at on the same array, which may evict its block; pointers handed to the
+ * apply functions of the maps stay good for the whole call. Taking one
+ * cell at a time, or at on a different array from the one mapped (as
+ * Pnm_ppmread, the transforms, A2_pack and ppmio do), is safe; holding
+ * two cells of one array from at is not. Blocks that were only read are
+ * not compressed again when evicted.
+ */
+
+extern A2Methods_T uarray2_methods_compressed;
+
+#endif
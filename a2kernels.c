@@ -0,0 +1,1566 @@
+/**************************************************************
+ *
+ *                     a2kernels.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of the SIMD pixel kernels and the layer
+ *              that dispatches to them. The x86 versions are compiled for
+ *              their instruction set with target attributes so one binary
+ *              runs on every processor; CPUID is probed once, through
+ *              pthread_once on the first kernel call from any thread, and
+ *              every kernel family is bound to the variants of the most
+ *              capable instruction set the processor supports.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "assert.h"
+#include "a2kernels.h"
+#include "a2transform.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define X86_KERNELS 1
+#endif
+
+/********** transpose32Scalar ********
+ *
+ * Transposes or rotates an n x n square of 32-bit elements one element at a
+ * time
+ *
+ * Parameters:
+ *      const void *vin:        the first element of the source square
+ *      int inStride:           elements between rows of the source
+ *      void *vout:             the first element of the destination square
+ *      int outStride:          elements between rows of the destination
+ *      int n:                  the width and height of the square
+ *      int orientation:        A2_TRANSPOSE, A2_ROTATE_90 or A2_ROTATE_270
+ *
+ * Return: n/a
+ *
+ ************************/
+static void transpose32Scalar(const void *vin, int inStride,
+                              void *vout, int outStride,
+                              int n, int orientation)
+{
+        const uint32_t *in = vin;
+        uint32_t *out = vout;
+
+        for (int r = 0; r < n; r++) {
+                for (int c = 0; c < n; c++) {
+                        /* (c, r) of out comes from (col, row) of in */
+                        int col = r;
+                        int row = c;
+                        if (orientation == A2_ROTATE_90) {
+                                row = n - c - 1;
+                        } else if (orientation == A2_ROTATE_270) {
+                                col = n - r - 1;
+                        }
+                        out[r * outStride + c] = in[row * inStride + col];
+                }
+        }
+}
+
+/*
+ * Defines a function that reverses n elements of exactly BYTES bytes, one
+ * element at a time
+ */
+#define REVERSE_SCALAR(NAME, BYTES)                                     \
+static void NAME(const char *in, char *out, int n, int size)           \
+{                                                                       \
+        (void) size;                                                    \
+        for (int k = 0; k < n; k++) {                                   \
+                memcpy(out + (size_t) k * (BYTES),                      \
+                       in + (size_t) (n - 1 - k) * (BYTES), BYTES);     \
+        }                                                               \
+}
+
+REVERSE_SCALAR(reverse1Scalar,    1)
+REVERSE_SCALAR(reverse2Scalar,    2)
+REVERSE_SCALAR(reverse3Scalar,    3)
+REVERSE_SCALAR(reverse4Scalar,    4)
+REVERSE_SCALAR(reverse8Scalar,    8)
+REVERSE_SCALAR(reverse12Scalar,  12)
+REVERSE_SCALAR(reverse16Scalar,  16)
+REVERSE_SCALAR(reverseAnyScalar, size)
+
+#undef REVERSE_SCALAR
+
+/********** reverseScalar ********
+ *
+ * Reverses n elements of any size without SIMD instructions
+ *
+ * Parameters: the same as A2Kernel_reverse
+ *
+ * Return: n/a
+ *
+ ************************/
+static void reverseScalar(const void *vin, void *vout, int n, int size)
+{
+        const char *in = vin;
+        char *out = vout;
+
+        switch (size) {
+        case 1:  reverse1Scalar(in, out, n, size);   break;
+        case 2:  reverse2Scalar(in, out, n, size);   break;
+        case 3:  reverse3Scalar(in, out, n, size);   break;
+        case 4:  reverse4Scalar(in, out, n, size);   break;
+        case 8:  reverse8Scalar(in, out, n, size);   break;
+        case 12: reverse12Scalar(in, out, n, size);  break;
+        case 16: reverse16Scalar(in, out, n, size);  break;
+        default: reverseAnyScalar(in, out, n, size); break;
+        }
+}
+
+/********** packScalar ********
+ *
+ * Packs n pixels of three unsigned channels one pixel at a time
+ *
+ * Parameters: the same as A2Kernel_pack
+ *
+ * Return: n/a
+ *
+ ************************/
+static void packScalar(const void *vrgb, void *out, int n, int size)
+{
+        const unsigned *rgb = vrgb;
+
+        if (size == 4) {
+                uint8_t *p = out;
+                for (int k = 0; k < n; k++, rgb += 3, p += 4) {
+                        p[0] = rgb[0];
+                        p[1] = rgb[1];
+                        p[2] = rgb[2];
+                        p[3] = 0;
+                }
+        } else {
+                uint16_t *p = out;
+                for (int k = 0; k < n; k++, rgb += 3, p += 4) {
+                        p[0] = rgb[0];
+                        p[1] = rgb[1];
+                        p[2] = rgb[2];
+                        p[3] = 0;
+                }
+        }
+}
+
+/********** unpackScalar ********
+ *
+ * Widens n packed pixels back to three unsigned channels one pixel at a time
+ *
+ * Parameters: the same as A2Kernel_unpack
+ *
+ * Return: n/a
+ *
+ ************************/
+static void unpackScalar(const void *in, void *vrgb, int n, int size)
+{
+        unsigned *rgb = vrgb;
+
+        if (size == 4) {
+                const uint8_t *p = in;
+                for (int k = 0; k < n; k++, rgb += 3, p += 4) {
+                        rgb[0] = p[0];
+                        rgb[1] = p[1];
+                        rgb[2] = p[2];
+                }
+        } else {
+                const uint16_t *p = in;
+                for (int k = 0; k < n; k++, rgb += 3, p += 4) {
+                        rgb[0] = p[0];
+                        rgb[1] = p[1];
+                        rgb[2] = p[2];
+                }
+        }
+}
+
+/********** splitScalar ********
+ *
+ * Deinterleaves n pixels of three unsigned channels into three planes one
+ * pixel at a time
+ *
+ * Parameters: the same as A2Kernel_split
+ *
+ * Return: n/a
+ *
+ ************************/
+static void splitScalar(const void *vrgb, void *const planes[3], int n,
+                        int depth)
+{
+        const unsigned *rgb = vrgb;
+
+        for (int c = 0; c < 3; c++) {
+                if (depth == 1) {
+                        uint8_t *p = planes[c];
+                        for (int k = 0; k < n; k++) {
+                                p[k] = rgb[3 * k + c];
+                        }
+                } else {
+                        uint16_t *p = planes[c];
+                        for (int k = 0; k < n; k++) {
+                                p[k] = rgb[3 * k + c];
+                        }
+                }
+        }
+}
+
+/********** mergeScalar ********
+ *
+ * Interleaves three planes into n pixels of three unsigned channels one
+ * pixel at a time
+ *
+ * Parameters: the same as A2Kernel_merge
+ *
+ * Return: n/a
+ *
+ ************************/
+static void mergeScalar(const void *const planes[3], void *vrgb, int n,
+                        int depth)
+{
+        unsigned *rgb = vrgb;
+
+        for (int c = 0; c < 3; c++) {
+                if (depth == 1) {
+                        const uint8_t *p = planes[c];
+                        for (int k = 0; k < n; k++) {
+                                rgb[3 * k + c] = p[k];
+                        }
+                } else {
+                        const uint16_t *p = planes[c];
+                        for (int k = 0; k < n; k++) {
+                                rgb[3 * k + c] = p[k];
+                        }
+                }
+        }
+}
+
+/********** parseScalar ********
+ *
+ * Converts n pixels of a P6 raster one channel at a time
+ *
+ * Parameters: the same as A2Kernel_parse
+ *
+ * Return: n/a
+ *
+ ************************/
+static void parseScalar(const void *vraster, void *out, int n, int depth,
+                        int size)
+{
+        const uint8_t *raster = vraster;
+
+        if (size == 3 * depth) {
+                memcpy(out, raster, (size_t) n * size);
+                return;
+        }
+        for (int k = 0; k < n; k++) {
+                for (int c = 0; c < 3; c++) {
+                        const uint8_t *sample = raster + (3 * k + c) * depth;
+                        unsigned value = sample[0];
+                        if (depth == 2) {
+                                value = (value << 8) | sample[1];
+                        }
+                        if (size == 4) {
+                                ((uint8_t *) out)[4 * k + c] = value;
+                        } else if (size == 8) {
+                                ((uint16_t *) out)[4 * k + c] = value;
+                        } else {
+                                ((unsigned *) out)[3 * k + c] = value;
+                        }
+                }
+                if (size == 4) {
+                        ((uint8_t *) out)[4 * k + 3] = 0;
+                } else if (size == 8) {
+                        ((uint16_t *) out)[4 * k + 3] = 0;
+                }
+        }
+}
+
+/********** formatScalar ********
+ *
+ * Converts n pixels to a P6 raster one channel at a time
+ *
+ * Parameters: the same as A2Kernel_format
+ *
+ * Return: n/a
+ *
+ ************************/
+static void formatScalar(const void *in, void *vraster, int n, int depth,
+                         int size)
+{
+        uint8_t *raster = vraster;
+
+        if (size == 3 * depth) {
+                memcpy(raster, in, (size_t) n * size);
+                return;
+        }
+        for (int k = 0; k < n; k++) {
+                for (int c = 0; c < 3; c++) {
+                        unsigned value;
+                        if (size == 4) {
+                                value = ((const uint8_t *) in)[4 * k + c];
+                        } else if (size == 8) {
+                                value = ((const uint16_t *) in)[4 * k + c];
+                        } else {
+                                value = ((const unsigned *) in)[3 * k + c];
+                        }
+                        uint8_t *sample = raster + (3 * k + c) * depth;
+                        if (depth == 2) {
+                                *sample++ = value >> 8;
+                        }
+                        *sample = value;
+                }
+        }
+}
+
+#ifdef X86_KERNELS
+
+/********** transpose8x8 ********
+ *
+ * Transposes eight rows of eight 32-bit lanes in registers: the unpacks
+ * interleave pairs of rows, the shuffles combine pairs of pairs, and the
+ * 128-bit permutes swap the upper and lower halves (24 instructions)
+ *
+ * Parameters:
+ *      __m256 *r:      the eight rows; row k holds column k afterwards
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("avx2")))
+static inline void transpose8x8(__m256 *r)
+{
+        __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+        __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+        __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+        __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+        __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+        __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+        __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+        __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+/********** transpose32Sse ********
+ *
+ * Transposes or rotates an n x n square of 32-bit elements 4 x 4 at a time
+ * with the SSE register transpose; the same scheme as transpose32Avx2 at half
+ * the width
+ *
+ * Parameters: the same as transpose32Scalar; n must be a multiple of 4
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void transpose32Sse(const void *vin, int inStride,
+                           void *vout, int outStride,
+                           int n, int orientation)
+{
+        const uint32_t *in = vin;
+        uint32_t *out = vout;
+
+        for (int by = 0; by < n; by += 4) {
+                for (int bx = 0; bx < n; bx += 4) {
+                        __m128 r[4];
+                        for (int k = 0; k < 4; k++) {
+                                const uint32_t *p = in + (by + k) * inStride
+                                                                        + bx;
+                                r[k] = _mm_castsi128_ps(
+                                        _mm_loadu_si128((const __m128i *) p));
+                        }
+                        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+                        for (int k = 0; k < 4; k++) {
+                                uint32_t *p;
+                                __m128 v = r[k];
+                                if (orientation == A2_ROTATE_90) {
+                                        p = out + (bx + k) * outStride
+                                                                + n - 4 - by;
+                                        v = _mm_shuffle_ps(v, v,
+                                                      _MM_SHUFFLE(0, 1, 2, 3));
+                                } else if (orientation == A2_ROTATE_270) {
+                                        p = out + (n - 1 - bx - k) * outStride
+                                                                         + by;
+                                } else {
+                                        p = out + (bx + k) * outStride + by;
+                                }
+                                _mm_storeu_si128((__m128i *) p,
+                                                 _mm_castps_si128(v));
+                        }
+                }
+        }
+}
+
+/********** transpose32Avx2 ********
+ *
+ * Transposes or rotates an n x n square of 32-bit elements 8 x 8 at a time.
+ * A 90 degree rotation is a transpose with every output row reversed, a 270
+ * degree rotation a transpose with the output rows in reverse order.
+ *
+ * Parameters: the same as transpose32Scalar; n must be a multiple of 8
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("avx2")))
+static void transpose32Avx2(const void *vin, int inStride,
+                            void *vout, int outStride,
+                            int n, int orientation)
+{
+        const uint32_t *in = vin;
+        uint32_t *out = vout;
+        const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+        for (int by = 0; by < n; by += 8) {
+                for (int bx = 0; bx < n; bx += 8) {
+                        __m256 r[8];
+                        for (int k = 0; k < 8; k++) {
+                                const uint32_t *p = in + (by + k) * inStride
+                                                                        + bx;
+                                __m256i row = _mm256_loadu_si256(
+                                        (const __m256i *) p);
+                                r[k] = _mm256_castsi256_ps(row);
+                        }
+                        transpose8x8(r);
+
+                        /* r[k] is now column bx + k of the source block */
+                        for (int k = 0; k < 8; k++) {
+                                uint32_t *p;
+                                __m256 v = r[k];
+                                if (orientation == A2_ROTATE_90) {
+                                        p = out + (bx + k) * outStride
+                                                                + n - 8 - by;
+                                        v = _mm256_permutevar8x32_ps(v,
+                                                                     reverse);
+                                } else if (orientation == A2_ROTATE_270) {
+                                        p = out + (n - 1 - bx - k) * outStride
+                                                                         + by;
+                                } else {
+                                        p = out + (bx + k) * outStride + by;
+                                }
+                                _mm256_storeu_si256((__m256i *) p,
+                                                    _mm256_castps_si256(v));
+                        }
+                }
+        }
+}
+
+/********** reverse3Ssse3 ********
+ *
+ * Reverses packed 3 byte pixels four at a time: one byte shuffle reverses
+ * the order of the last four pixels of a 16 byte load while keeping the
+ * bytes of each pixel in order
+ *
+ * Parameters: the same as A2Kernel_reverse with size 3
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void reverse3Ssse3(const char *in, char *out, int n)
+{
+        const __m128i order = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9,
+                                            4, 5, 6, -1, -1, -1, -1);
+        int k = 0;
+
+        /* each load reads 16 bytes ending with the pixels it moves, so it
+         * starts 4 bytes (more than one pixel) before them */
+        for (; k + 6 <= n; k += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *)
+                                        (in + (size_t) (n - 4 - k) * 3 - 4));
+                v = _mm_shuffle_epi8(v, order);
+                char *p = out + (size_t) k * 3;
+                _mm_storel_epi64((__m128i *) p, v);
+                uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+                memcpy(p + 8, &last, 4);
+        }
+        reverse3Scalar(in, out + (size_t) k * 3, n - k, 3);
+}
+
+/********** reverse4Avx2 ********
+ *
+ * Reverses 4 byte elements eight at a time with one lane permute
+ *
+ * Parameters: the same as A2Kernel_reverse with size 4
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("avx2")))
+static void reverse4Avx2(const char *in, char *out, int n)
+{
+        const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        int k = 0;
+
+        for (; k + 8 <= n; k += 8) {
+                __m256i v = _mm256_loadu_si256((const __m256i *)
+                                            (in + (size_t) (n - 8 - k) * 4));
+                v = _mm256_permutevar8x32_epi32(v, reverse);
+                _mm256_storeu_si256((__m256i *) (out + (size_t) k * 4), v);
+        }
+        reverse4Scalar(in, out + (size_t) k * 4, n - k, 4);
+}
+
+/********** reverse4Sse2 ********
+ *
+ * Reverses 4 byte elements four at a time with one dword shuffle
+ *
+ * Parameters: the same as A2Kernel_reverse with size 4
+ *
+ * Return: n/a
+ *
+ ************************/
+static void reverse4Sse2(const char *in, char *out, int n)
+{
+        int k = 0;
+
+        for (; k + 4 <= n; k += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *)
+                                            (in + (size_t) (n - 4 - k) * 4));
+                v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+                _mm_storeu_si128((__m128i *) (out + (size_t) k * 4), v);
+        }
+        reverse4Scalar(in, out + (size_t) k * 4, n - k, 4);
+}
+
+/********** reverse12Avx2 ********
+ *
+ * Reverses 12 byte elements (such as struct Pnm_rgb) four at a time. The
+ * four elements are twelve 32-bit words loaded as words 0-7 and 4-11; the
+ * first eight output words are permuted out of the second load except word
+ * 3, which is blended in from the first, and the last four output words are
+ * permuted out of the first load.
+ *
+ * Parameters: the same as A2Kernel_reverse with size 12
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("avx2")))
+static void reverse12Avx2(const char *in, char *out, int n)
+{
+        const __m256i highOrder = _mm256_setr_epi32(5, 6, 7, 2, 3, 4, 0, 0);
+        const __m256i lowOrder = _mm256_setr_epi32(5, 0, 1, 2, 0, 0, 3, 0);
+        int k = 0;
+
+        for (; k + 4 <= n; k += 4) {
+                const char *p = in + (size_t) (n - 4 - k) * 12;
+                char *q = out + (size_t) k * 12;
+                __m256i low = _mm256_loadu_si256((const __m256i *) p);
+                __m256i high = _mm256_loadu_si256((const __m256i *) (p + 16));
+                __m256i fromLow = _mm256_permutevar8x32_epi32(low, lowOrder);
+                __m256i first = _mm256_blend_epi32(
+                        _mm256_permutevar8x32_epi32(high, highOrder),
+                        fromLow, 0x40);
+                _mm256_storeu_si256((__m256i *) q, first);
+                _mm_storeu_si128((__m128i *) (q + 32),
+                                 _mm256_castsi256_si128(fromLow));
+        }
+        reverse12Scalar(in, out + (size_t) k * 12, n - k, 12);
+}
+
+/********** reverse4Avx512 ********
+ *
+ * Reverses 4 byte elements sixteen at a time with one lane permute
+ *
+ * Parameters: the same as A2Kernel_reverse with size 4
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("avx512f")))
+static void reverse4Avx512(const char *in, char *out, int n)
+{
+        const __m512i reverse = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9,
+                                                  8, 7, 6, 5, 4, 3, 2, 1, 0);
+        int k = 0;
+
+        for (; k + 16 <= n; k += 16) {
+                __m512i v = _mm512_loadu_si512(in + (size_t) (n - 16 - k) * 4);
+                v = _mm512_permutexvar_epi32(reverse, v);
+                _mm512_storeu_si512(out + (size_t) k * 4, v);
+        }
+        reverse4Avx2(in, out + (size_t) k * 4, n - k);
+}
+
+/********** reverseSse42, reverseAvx2, reverseAvx512 ********
+ *
+ * The reverse family for each instruction set: element sizes with a vector
+ * path at that level use it, every other size the scalar version
+ *
+ * Parameters: the same as A2Kernel_reverse
+ *
+ * Return: n/a
+ *
+ ************************/
+static void reverseSse42(const void *in, void *out, int n, int size)
+{
+        if (size == 3) {
+                reverse3Ssse3(in, out, n);
+        } else if (size == 4) {
+                reverse4Sse2(in, out, n);
+        } else {
+                reverseScalar(in, out, n, size);
+        }
+}
+
+static void reverseAvx2(const void *in, void *out, int n, int size)
+{
+        if (size == 4) {
+                reverse4Avx2(in, out, n);
+        } else if (size == 12) {
+                reverse12Avx2(in, out, n);
+        } else {
+                reverseSse42(in, out, n, size);
+        }
+}
+
+static void reverseAvx512(const void *in, void *out, int n, int size)
+{
+        if (size == 4) {
+                reverse4Avx512(in, out, n);
+        } else {
+                reverseAvx2(in, out, n, size);
+        }
+}
+
+/********** packSse42 ********
+ *
+ * Packs four pixels per step: the twelve channels arrive in three vectors
+ * and byte shuffles move the low byte (4 byte pixels) or, after an unsigned
+ * saturating narrow, the low half (8 byte pixels) of each channel into place
+ * with the padding channel zeroed
+ *
+ * Parameters: the same as A2Kernel_pack
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void packSse42(const void *vrgb, void *vout, int n, int size)
+{
+        const unsigned *rgb = vrgb;
+        char *out = vout;
+        int k = 0;
+
+        if (size == 4) {
+                const __m128i first  = _mm_setr_epi8(0, 4, 8, -1, 12, -1, -1,
+                                                     -1, -1, -1, -1, -1, -1,
+                                                     -1, -1, -1);
+                const __m128i second = _mm_setr_epi8(-1, -1, -1, -1, -1, 0,
+                                                     4, -1, 8, 12, -1, -1, -1,
+                                                     -1, -1, -1);
+                const __m128i third  = _mm_setr_epi8(-1, -1, -1, -1, -1, -1,
+                                                     -1, -1, -1, -1, 0, -1, 4,
+                                                     8, 12, -1);
+                for (; k + 4 <= n; k += 4) {
+                        const __m128i *p = (const __m128i *) (rgb + 3 * k);
+                        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(p),
+                                                                        first);
+                        v = _mm_or_si128(v, _mm_shuffle_epi8(
+                                        _mm_loadu_si128(p + 1), second));
+                        v = _mm_or_si128(v, _mm_shuffle_epi8(
+                                        _mm_loadu_si128(p + 2), third));
+                        _mm_storeu_si128((__m128i *) (out + 4 * k), v);
+                }
+        } else {
+                /* words 0, 1, 2 and 3, 4, 5 to two pixels with zeros */
+                const __m128i spread = _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1,
+                                                     6, 7, 8, 9, 10, 11, -1,
+                                                     -1);
+                for (; k + 4 <= n; k += 4) {
+                        const __m128i *p = (const __m128i *) (rgb + 3 * k);
+                        __m128i low  = _mm_packus_epi32(_mm_loadu_si128(p),
+                                                      _mm_loadu_si128(p + 1));
+                        __m128i high = _mm_packus_epi32(_mm_loadu_si128(p + 2),
+                                                        _mm_setzero_si128());
+                        __m128i mid  = _mm_alignr_epi8(high, low, 12);
+                        _mm_storeu_si128((__m128i *) (out + 8 * k),
+                                         _mm_shuffle_epi8(low, spread));
+                        _mm_storeu_si128((__m128i *) (out + 8 * k + 16),
+                                         _mm_shuffle_epi8(mid, spread));
+                }
+        }
+        packScalar(rgb + 3 * k, out + (size_t) k * size, n - k, size);
+}
+
+/********** unpackSse42 ********
+ *
+ * Widens four pixels per step: byte shuffles (4 byte pixels) or a shuffle
+ * that drops the padding followed by zero extension (8 byte pixels) produce
+ * the three vectors of twelve unsigned channels
+ *
+ * Parameters: the same as A2Kernel_unpack
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void unpackSse42(const void *vin, void *vrgb, int n, int size)
+{
+        const char *in = vin;
+        unsigned *rgb = vrgb;
+        int k = 0;
+
+        if (size == 4) {
+                const __m128i first  = _mm_setr_epi8(0, -1, -1, -1, 1, -1, -1,
+                                                     -1, 2, -1, -1, -1, 4, -1,
+                                                     -1, -1);
+                const __m128i second = _mm_setr_epi8(5, -1, -1, -1, 6, -1, -1,
+                                                     -1, 8, -1, -1, -1, 9, -1,
+                                                     -1, -1);
+                const __m128i third  = _mm_setr_epi8(10, -1, -1, -1, 12, -1,
+                                                     -1, -1, 13, -1, -1, -1,
+                                                     14, -1, -1, -1);
+                for (; k + 4 <= n; k += 4) {
+                        __m128i v = _mm_loadu_si128((const __m128i *)
+                                                               (in + 4 * k));
+                        __m128i *p = (__m128i *) (rgb + 3 * k);
+                        _mm_storeu_si128(p,     _mm_shuffle_epi8(v, first));
+                        _mm_storeu_si128(p + 1, _mm_shuffle_epi8(v, second));
+                        _mm_storeu_si128(p + 2, _mm_shuffle_epi8(v, third));
+                }
+        } else {
+                /* two pixels to words 0, 1, 2 and 3, 4, 5 */
+                const __m128i squeeze = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9,
+                                                      10, 11, 12, 13, -1, -1,
+                                                      -1, -1);
+                for (; k + 4 <= n; k += 4) {
+                        const __m128i *q = (const __m128i *) (in + 8 * k);
+                        __m128i low  = _mm_shuffle_epi8(_mm_loadu_si128(q),
+                                                                      squeeze);
+                        __m128i high = _mm_shuffle_epi8(_mm_loadu_si128(q + 1),
+                                                                      squeeze);
+                        low = _mm_or_si128(low, _mm_slli_si128(high, 12));
+                        high = _mm_srli_si128(high, 4);
+
+                        __m128i *p = (__m128i *) (rgb + 3 * k);
+                        _mm_storeu_si128(p,     _mm_cvtepu16_epi32(low));
+                        _mm_storeu_si128(p + 1, _mm_cvtepu16_epi32(
+                                                     _mm_srli_si128(low, 8)));
+                        _mm_storeu_si128(p + 2, _mm_cvtepu16_epi32(high));
+                }
+        }
+        unpackScalar(in + (size_t) k * size, rgb + 3 * k, n - k, size);
+}
+
+/*
+ * pshufb masks that deinterleave channels: splitMasks[depth - 1][channel][k]
+ * moves that channel's samples out of the k-th of three vectors of
+ * interleaved samples into their place in the plane vector
+ */
+static const int8_t splitMasks[2][3][3][16] = {
+        {
+                {
+                        { 0,3,6,9,12,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,2,5,8,11,14,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,1,4,7,10,13 },
+                },
+                {
+                        { 1,4,7,10,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,0,3,6,9,12,15,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,2,5,8,11,14 },
+                },
+                {
+                        { 2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,1,4,7,10,13,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,3,6,9,12,15 },
+                },
+        },
+        {
+                {
+                        { 0,1,6,7,12,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,2,3,8,9,14,15,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,4,5,10,11 },
+                },
+                {
+                        { 2,3,8,9,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,4,5,10,11,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,1,6,7,12,13 },
+                },
+                {
+                        { 4,5,10,11,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,0,1,6,7,12,13,-1,-1,-1,-1,-1,-1 },
+                        { -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,2,3,8,9,14,15 },
+                },
+        },
+};
+
+/*
+ * pshufb masks that interleave planes: mergeMasks[depth - 1][k][channel]
+ * moves samples of that channel's plane vector into their place in the k-th
+ * of three vectors of interleaved samples
+ */
+static const int8_t mergeMasks[2][3][3][16] = {
+        {
+                {
+                        { 0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1,5 },
+                        { -1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1 },
+                        { -1,-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1 },
+                },
+                {
+                        { -1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10,-1 },
+                        { 5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10 },
+                        { -1,5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1 },
+                },
+                {
+                        { -1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1 },
+                        { -1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1 },
+                        { 10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15 },
+                },
+        },
+        {
+                {
+                        { 0,1,-1,-1,-1,-1,2,3,-1,-1,-1,-1,4,5,-1,-1 },
+                        { -1,-1,0,1,-1,-1,-1,-1,2,3,-1,-1,-1,-1,4,5 },
+                        { -1,-1,-1,-1,0,1,-1,-1,-1,-1,2,3,-1,-1,-1,-1 },
+                },
+                {
+                        { -1,-1,6,7,-1,-1,-1,-1,8,9,-1,-1,-1,-1,10,11 },
+                        { -1,-1,-1,-1,6,7,-1,-1,-1,-1,8,9,-1,-1,-1,-1 },
+                        { 4,5,-1,-1,-1,-1,6,7,-1,-1,-1,-1,8,9,-1,-1 },
+                },
+                {
+                        { -1,-1,-1,-1,12,13,-1,-1,-1,-1,14,15,-1,-1,-1,-1 },
+                        { 10,11,-1,-1,-1,-1,12,13,-1,-1,-1,-1,14,15,-1,-1 },
+                        { -1,-1,10,11,-1,-1,-1,-1,12,13,-1,-1,-1,-1,14,15 },
+                },
+        },
+};
+
+/********** splitSse42 ********
+ *
+ * Deinterleaves one vector of samples per plane per step: the unsigned
+ * channels are narrowed with saturating packs into three vectors of
+ * interleaved samples, and three shuffles per plane pick that plane's
+ * samples out of them
+ *
+ * Parameters: the same as A2Kernel_split
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void splitSse42(const void *vrgb, void *const planes[3], int n,
+                       int depth)
+{
+        const unsigned *rgb = vrgb;
+        int step = 16 / depth;          /* pixels per step */
+        int k = 0;
+
+        for (; k + step <= n; k += step) {
+                const __m128i *p = (const __m128i *) (rgb + 3 * k);
+                __m128i in[3];
+                for (int v = 0; v < 3; v++) {
+                        if (depth == 1) {
+                                const __m128i *q = p + 4 * v;
+                                in[v] = _mm_packus_epi16(
+                                        _mm_packus_epi32(_mm_loadu_si128(q),
+                                                     _mm_loadu_si128(q + 1)),
+                                        _mm_packus_epi32(
+                                                     _mm_loadu_si128(q + 2),
+                                                     _mm_loadu_si128(q + 3)));
+                        } else {
+                                in[v] = _mm_packus_epi32(
+                                                _mm_loadu_si128(p + 2 * v),
+                                                _mm_loadu_si128(p + 2 * v + 1));
+                        }
+                }
+                for (int c = 0; c < 3; c++) {
+                        const int8_t (*masks)[16] = splitMasks[depth - 1][c];
+                        __m128i plane = _mm_setzero_si128();
+                        for (int v = 0; v < 3; v++) {
+                                __m128i mask = _mm_loadu_si128(
+                                                (const __m128i *) masks[v]);
+                                plane = _mm_or_si128(plane,
+                                                _mm_shuffle_epi8(in[v], mask));
+                        }
+                        _mm_storeu_si128((__m128i *) ((char *) planes[c] +
+                                                 (size_t) k * depth), plane);
+                }
+        }
+        if (k < n) {
+                void *rest[3];
+                for (int c = 0; c < 3; c++) {
+                        rest[c] = (char *) planes[c] + (size_t) k * depth;
+                }
+                splitScalar(rgb + 3 * k, rest, n - k, depth);
+        }
+}
+
+/********** mergeSse42 ********
+ *
+ * Interleaves one vector of samples per plane per step: three shuffles per
+ * output vector weave the planes together, and zero extension widens the
+ * interleaved samples to unsigned channels
+ *
+ * Parameters: the same as A2Kernel_merge
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void mergeSse42(const void *const planes[3], void *vrgb, int n,
+                       int depth)
+{
+        unsigned *rgb = vrgb;
+        int step = 16 / depth;          /* pixels per step */
+        int k = 0;
+
+        for (; k + step <= n; k += step) {
+                __m128i in[3];
+                for (int c = 0; c < 3; c++) {
+                        const char *plane = planes[c];
+                        in[c] = _mm_loadu_si128((const __m128i *)
+                                                (plane + (size_t) k * depth));
+                }
+                __m128i *p = (__m128i *) (rgb + 3 * k);
+                for (int v = 0; v < 3; v++) {
+                        const int8_t (*masks)[16] = mergeMasks[depth - 1][v];
+                        __m128i out = _mm_setzero_si128();
+                        for (int c = 0; c < 3; c++) {
+                                __m128i mask = _mm_loadu_si128(
+                                                (const __m128i *) masks[c]);
+                                out = _mm_or_si128(out,
+                                                _mm_shuffle_epi8(in[c], mask));
+                        }
+                        if (depth == 1) {
+                                _mm_storeu_si128(p + 4 * v,
+                                                 _mm_cvtepu8_epi32(out));
+                                _mm_storeu_si128(p + 4 * v + 1,
+                                                 _mm_cvtepu8_epi32(
+                                                 _mm_srli_si128(out, 4)));
+                                _mm_storeu_si128(p + 4 * v + 2,
+                                                 _mm_cvtepu8_epi32(
+                                                 _mm_srli_si128(out, 8)));
+                                _mm_storeu_si128(p + 4 * v + 3,
+                                                 _mm_cvtepu8_epi32(
+                                                 _mm_srli_si128(out, 12)));
+                        } else {
+                                _mm_storeu_si128(p + 2 * v,
+                                                 _mm_cvtepu16_epi32(out));
+                                _mm_storeu_si128(p + 2 * v + 1,
+                                                 _mm_cvtepu16_epi32(
+                                                 _mm_srli_si128(out, 8)));
+                        }
+                }
+        }
+        if (k < n) {
+                const void *rest[3];
+                for (int c = 0; c < 3; c++) {
+                        rest[c] = (const char *) planes[c] +
+                                                        (size_t) k * depth;
+                }
+                mergeScalar(rest, rgb + 3 * k, n - k, depth);
+        }
+}
+
+/********** parseSse42 ********
+ *
+ * Converts a P6 raster a vector at a time: one shuffle spreads 8-bit samples
+ * into padded 4 byte pixels or byte swaps big endian 16-bit samples into
+ * padded 8 byte pixels, and zero extension widens either to unsigned
+ * channels. Every load stays inside the n pixels of the raster.
+ *
+ * Parameters: the same as A2Kernel_parse
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void parseSse42(const void *vraster, void *vout, int n, int depth,
+                       int size)
+{
+        const char *raster = vraster;
+        char *out = vout;
+        int k = 0;
+
+        if (size == 3 * depth) {
+                memcpy(out, raster, (size_t) n * size);
+                return;
+        }
+        if (depth == 1) {
+                const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+                                                     6, 7, 8, -1, 9, 10, 11,
+                                                     -1);
+                for (; k + 6 <= n; k += 4) {
+                        __m128i v = _mm_loadu_si128((const __m128i *)
+                                                            (raster + 3 * k));
+                        if (size == 4) {
+                                _mm_storeu_si128((__m128i *) (out + 4 * k),
+                                                 _mm_shuffle_epi8(v, spread));
+                                continue;
+                        }
+                        __m128i *p = (__m128i *) (out + 12 * k);
+                        _mm_storeu_si128(p,     _mm_cvtepu8_epi32(v));
+                        _mm_storeu_si128(p + 1, _mm_cvtepu8_epi32(
+                                                      _mm_srli_si128(v, 4)));
+                        _mm_storeu_si128(p + 2, _mm_cvtepu8_epi32(
+                                                      _mm_srli_si128(v, 8)));
+                }
+        } else {
+                const __m128i padded = _mm_setr_epi8(1, 0, 3, 2, 5, 4, -1, -1,
+                                                     7, 6, 9, 8, 11, 10, -1,
+                                                     -1);
+                const __m128i packed = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+                                                     9, 8, 11, 10, -1, -1, -1,
+                                                     -1);
+                for (; k + 3 <= n; k += 2) {
+                        __m128i v = _mm_loadu_si128((const __m128i *)
+                                                            (raster + 6 * k));
+                        if (size == 8) {
+                                _mm_storeu_si128((__m128i *) (out + 8 * k),
+                                                 _mm_shuffle_epi8(v, padded));
+                                continue;
+                        }
+                        v = _mm_shuffle_epi8(v, packed);
+                        __m128i *p = (__m128i *) (out + 12 * k);
+                        _mm_storeu_si128(p, _mm_cvtepu16_epi32(v));
+                        _mm_storel_epi64(p + 1, _mm_cvtepu16_epi32(
+                                                      _mm_srli_si128(v, 8)));
+                }
+        }
+        parseScalar(raster + (size_t) k * 3 * depth,
+                    out + (size_t) k * size, n - k, depth, size);
+}
+
+/********** formatSse42 ********
+ *
+ * Converts pixels to a P6 raster a vector at a time: one shuffle drops the
+ * padding of packed pixels (byte swapping 16-bit samples to big endian), and
+ * saturating packs narrow unsigned channels first. Each step stores a whole
+ * vector of which only the first 12 bytes are kept, so the loops stop while
+ * the raster still has room for it.
+ *
+ * Parameters: the same as A2Kernel_format
+ *
+ * Return: n/a
+ *
+ ************************/
+__attribute__((target("sse4.2")))
+static void formatSse42(const void *vin, void *vraster, int n, int depth,
+                        int size)
+{
+        const char *in = vin;
+        char *raster = vraster;
+        int k = 0;
+
+        if (size == 3 * depth) {
+                memcpy(raster, in, (size_t) n * size);
+                return;
+        }
+        if (depth == 1) {
+                const __m128i squeeze = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                                      10, 12, 13, 14, -1, -1,
+                                                      -1, -1);
+                for (; k + 6 <= n; k += 4) {
+                        __m128i v;
+                        if (size == 4) {
+                                v = _mm_loadu_si128((const __m128i *)
+                                                                (in + 4 * k));
+                                v = _mm_shuffle_epi8(v, squeeze);
+                        } else {
+                                const __m128i *p = (const __m128i *)
+                                                                (in + 12 * k);
+                                v = _mm_packus_epi16(
+                                        _mm_packus_epi32(_mm_loadu_si128(p),
+                                                     _mm_loadu_si128(p + 1)),
+                                        _mm_packus_epi32(
+                                                     _mm_loadu_si128(p + 2),
+                                                     _mm_setzero_si128()));
+                        }
+                        _mm_storeu_si128((__m128i *) (raster + 3 * k), v);
+                }
+        } else {
+                const __m128i padded = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 9, 8,
+                                                     11, 10, 13, 12, -1, -1,
+                                                     -1, -1);
+                const __m128i packed = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6,
+                                                     9, 8, 11, 10, -1, -1, -1,
+                                                     -1);
+                for (; k + 3 <= n; k += 2) {
+                        __m128i v;
+                        if (size == 8) {
+                                v = _mm_loadu_si128((const __m128i *)
+                                                                (in + 8 * k));
+                                v = _mm_shuffle_epi8(v, padded);
+                        } else {
+                                const char *p = in + 12 * k;
+                                v = _mm_packus_epi32(
+                                        _mm_loadu_si128((const __m128i *) p),
+                                        _mm_loadl_epi64((const __m128i *)
+                                                                   (p + 16)));
+                                v = _mm_shuffle_epi8(v, packed);
+                        }
+                        _mm_storeu_si128((__m128i *) (raster + 6 * k), v);
+                }
+        }
+        formatScalar(in + (size_t) k * size,
+                     raster + (size_t) k * 3 * depth, n - k, depth, size);
+}
+
+#endif
+
+typedef void transposefun(const void *in, int inStride, void *out,
+                          int outStride, int n, int orientation);
+typedef void reversefun(const void *in, void *out, int n, int size);
+typedef void packfun(const void *rgb, void *out, int n, int size);
+typedef void unpackfun(const void *in, void *rgb, int n, int size);
+typedef void splitfun(const void *rgb, void *const planes[3], int n,
+                      int depth);
+typedef void mergefun(const void *const planes[3], void *rgb, int n,
+                      int depth);
+typedef void parsefun(const void *raster, void *out, int n, int depth,
+                      int size);
+typedef void formatfun(const void *in, void *raster, int n, int depth,
+                       int size);
+
+/*
+ * One complete set of kernel variants per instruction set level, from the
+ * most portable to the most capable. A level reuses the variant of a lower
+ * level for a family it has no faster version of, and names which one it
+ * uses so -isa-info can report it.
+ */
+static const struct kernelSet {
+        const char *isa;                /* name accepted by A2Kernel_select */
+        transposefun *transpose32;
+        const char *transpose32Isa;
+        reversefun *reverse;
+        const char *reverseIsa;
+        packfun *pack;
+        unpackfun *unpack;
+        const char *packIsa;
+        splitfun *split;
+        mergefun *merge;
+        const char *planarIsa;
+        parsefun *parse;
+        formatfun *format;
+        const char *parseIsa;
+} kernelSets[] = {
+        { "scalar", transpose32Scalar, "scalar", reverseScalar, "scalar",
+                    packScalar, unpackScalar, "scalar",
+                    splitScalar, mergeScalar, "scalar",
+                    parseScalar, formatScalar, "scalar" },
+#ifdef X86_KERNELS
+        { "sse4.2", transpose32Sse,    "sse4.2", reverseSse42,  "sse4.2",
+                    packSse42,  unpackSse42,  "sse4.2",
+                    splitSse42, mergeSse42,   "sse4.2",
+                    parseSse42,  formatSse42,  "sse4.2" },
+        { "avx2",   transpose32Avx2,   "avx2",   reverseAvx2,   "avx2",
+                    packSse42,  unpackSse42,  "sse4.2",
+                    splitSse42, mergeSse42,   "sse4.2",
+                    parseSse42,  formatSse42,  "sse4.2" },
+        { "avx512", transpose32Avx2,   "avx2",   reverseAvx512, "avx512",
+                    packSse42,  unpackSse42,  "sse4.2",
+                    splitSse42, mergeSse42,   "sse4.2",
+                    parseSse42,  formatSse42,  "sse4.2" },
+#endif
+};
+
+#define LEVELS ((int) (sizeof(kernelSets) / sizeof(kernelSets[0])))
+
+/* the set every kernel call goes through; NULL until bindSupported has run
+ * once, after which only A2Kernel_select changes it */
+static const struct kernelSet *bound = NULL;
+static pthread_once_t bindOnce = PTHREAD_ONCE_INIT;
+
+/********** supportedLevel ********
+ *
+ * Asks the processor (through CPUID) for the most capable kernel set it can
+ * run
+ *
+ * Return: an index into kernelSets
+ *
+ ************************/
+static int supportedLevel(void)
+{
+#ifdef X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw")) {
+                return 3;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+                return 2;
+        }
+        if (__builtin_cpu_supports("sse4.2") &&
+            __builtin_cpu_supports("ssse3")) {
+                return 1;
+        }
+#endif
+        return 0;
+}
+
+/********** bindSupported ********
+ *
+ * Binds the most capable kernel set the processor supports; run once
+ * through bindOnce
+ *
+ * Return: n/a
+ *
+ ************************/
+static void bindSupported(void)
+{
+        bound = &kernelSets[supportedLevel()];
+}
+
+/********** kernels ********
+ *
+ * Gets the bound kernel set, binding the most capable supported one on the
+ * first call from any thread
+ *
+ * Return: the bound kernel set
+ *
+ * Notes:
+ *      - Threads making their first calls at once all wait for the one
+ *      binding, so none sees bound half set or NULL
+ *
+ ************************/
+static inline const struct kernelSet *kernels(void)
+{
+        pthread_once(&bindOnce, bindSupported);
+        return bound;
+}
+
+/********** A2Kernel_select ********
+ *
+ * Binds every kernel family to the variants of a named instruction set,
+ * overriding the choice made from CPUID
+ *
+ * Parameters:
+ *      const char *isa:        "scalar", "sse4.2", "avx2" or "avx512"
+ *
+ * Return: true if the kernels were bound, false if the name is unknown or
+ *         the processor cannot run that instruction set
+ *
+ * Expects: isa to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if isa is NULL
+ *      - Meant for startup: it must not run while other threads make
+ *      kernel calls
+ *
+ ************************/
+bool A2Kernel_select(const char *isa)
+{
+        assert(isa != NULL);
+
+        /* bind first so the lazy binding cannot later undo this one */
+        pthread_once(&bindOnce, bindSupported);
+        int supported = supportedLevel();
+        for (int level = 0; level < LEVELS; level++) {
+                if (strcmp(kernelSets[level].isa, isa) == 0) {
+                        if (level > supported) {
+                                return false;
+                        }
+                        bound = &kernelSets[level];
+                        return true;
+                }
+        }
+        return false;
+}
+
+/********** A2Kernel_print ********
+ *
+ * Prints the instruction set of the bound kernel set and of the variant
+ * bound for each kernel family
+ *
+ * Parameters:
+ *      FILE *fp:       where to print
+ *
+ * Return: n/a
+ *
+ * Expects: fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if fp is NULL
+ *
+ ************************/
+void A2Kernel_print(FILE *fp)
+{
+        assert(fp != NULL);
+
+        const struct kernelSet *set = kernels();
+        fprintf(fp, "kernel isa:  %s (best supported: %s)\n", set->isa,
+                                          kernelSets[supportedLevel()].isa);
+        fprintf(fp, "transpose32: %s\n", set->transpose32Isa);
+        fprintf(fp, "reverse:     %s\n", set->reverseIsa);
+        fprintf(fp, "pack:        %s\n", set->packIsa);
+        fprintf(fp, "planar:      %s\n", set->planarIsa);
+        fprintf(fp, "parse/format: %s\n", set->parseIsa);
+}
+
+/********** A2Kernel_transpose32 ********
+ *
+ * Transposes, or rotates by 90 or 270 degrees, an n x n square of 32-bit
+ * elements with the bound transpose variant
+ *
+ * Parameters:
+ *      const void *in:         the first element of the source square
+ *      int inStride:           elements between rows of the source
+ *      void *out:              the first element of the destination square
+ *      int outStride:          elements between rows of the destination
+ *      int n:                  the width and height of the square
+ *      int orientation:        A2_TRANSPOSE, A2_ROTATE_90 or A2_ROTATE_270
+ *
+ * Return: n/a
+ *
+ * Expects: in and out to not be NULL or overlap, n to be a positive multiple
+ *          of 8 and orientation to be one of the three listed
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Kernel_transpose32(const void *in, int inStride, void *out,
+                          int outStride, int n, int orientation)
+{
+        assert(in != NULL && out != NULL);
+        assert(n > 0 && n % 8 == 0);
+        assert(orientation == A2_TRANSPOSE || orientation == A2_ROTATE_90 ||
+               orientation == A2_ROTATE_270);
+
+        kernels()->transpose32(in, inStride, out, outStride, n, orientation);
+}
+
+/********** A2Kernel_reverse ********
+ *
+ * Copies n elements from in to out in reverse order with the bound reverse
+ * variant
+ *
+ * Parameters:
+ *      const void *in:         the first source element
+ *      void *out:              the first destination element
+ *      int n:                  the number of elements
+ *      int size:               the number of bytes in an element
+ *
+ * Return: n/a
+ *
+ * Expects: in and out to not be NULL or overlap, n to be non-negative and
+ *          size to be positive
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Kernel_reverse(const void *in, void *out, int n, int size)
+{
+        assert(in != NULL && out != NULL);
+        assert(n >= 0 && size > 0);
+
+        kernels()->reverse(in, out, n, size);
+}
+
+/********** A2Kernel_pack ********
+ *
+ * Packs n pixels of three unsigned channels (the layout of struct Pnm_rgb)
+ * into 4 byte pixels (one byte per channel) or 8 byte pixels (16 bits per
+ * channel), the last channel of each being zero padding
+ *
+ * Parameters:
+ *      const void *rgb:        the first channel of the first pixel
+ *      void *out:              where the first packed pixel goes
+ *      int n:                  the number of pixels
+ *      int size:               4 or 8, the bytes in a packed pixel
+ *
+ * Return: n/a
+ *
+ * Expects: rgb and out to not be NULL or overlap, n to be non-negative, size
+ *          to be 4 or 8 and every channel to fit in a byte (size 4) or in 16
+ *          bits (size 8)
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations, other than the channel range,
+ *        are violated
+ *      - Channels out of range are truncated or saturated
+ *
+ ************************/
+void A2Kernel_pack(const void *rgb, void *out, int n, int size)
+{
+        assert(rgb != NULL && out != NULL);
+        assert(n >= 0 && (size == 4 || size == 8));
+
+        kernels()->pack(rgb, out, n, size);
+}
+
+/********** A2Kernel_unpack ********
+ *
+ * Widens n pixels packed by A2Kernel_pack back to three unsigned channels
+ *
+ * Parameters:
+ *      const void *in:         the first packed pixel
+ *      void *rgb:              where the first channel of the first pixel
+ *                              goes
+ *      int n:                  the number of pixels
+ *      int size:               4 or 8, the bytes in a packed pixel
+ *
+ * Return: n/a
+ *
+ * Expects: in and rgb to not be NULL or overlap, n to be non-negative and
+ *          size to be 4 or 8
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Kernel_unpack(const void *in, void *rgb, int n, int size)
+{
+        assert(in != NULL && rgb != NULL);
+        assert(n >= 0 && (size == 4 || size == 8));
+
+        kernels()->unpack(in, rgb, n, size);
+}
+
+/********** A2Kernel_split ********
+ *
+ * Deinterleaves n pixels of three unsigned channels (the layout of struct
+ * Pnm_rgb) into three planes of 8-bit or 16-bit samples
+ *
+ * Parameters:
+ *      const void *rgb:        the first channel of the first pixel
+ *      void *const planes[3]:  where the red, green and blue samples go
+ *      int n:                  the number of pixels
+ *      int depth:              1 or 2, the bytes in a sample
+ *
+ * Return: n/a
+ *
+ * Expects: rgb and every plane to not be NULL or overlap, n to be
+ *          non-negative, depth to be 1 or 2 and every channel to fit in a
+ *          sample
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations, other than the channel range,
+ *        are violated
+ *
+ ************************/
+void A2Kernel_split(const void *rgb, void *const planes[3], int n, int depth)
+{
+        assert(rgb != NULL && planes != NULL);
+        assert(planes[0] != NULL && planes[1] != NULL && planes[2] != NULL);
+        assert(n >= 0 && (depth == 1 || depth == 2));
+
+        kernels()->split(rgb, planes, n, depth);
+}
+
+/********** A2Kernel_merge ********
+ *
+ * Interleaves three planes of 8-bit or 16-bit samples into n pixels of three
+ * unsigned channels
+ *
+ * Parameters:
+ *      const void *const planes[3]:    the red, green and blue samples
+ *      void *rgb:                      where the first channel of the first
+ *                                      pixel goes
+ *      int n:                          the number of pixels
+ *      int depth:                      1 or 2, the bytes in a sample
+ *
+ * Return: n/a
+ *
+ * Expects: rgb and every plane to not be NULL or overlap, n to be
+ *          non-negative and depth to be 1 or 2
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Kernel_merge(const void *const planes[3], void *rgb, int n, int depth)
+{
+        assert(rgb != NULL && planes != NULL);
+        assert(planes[0] != NULL && planes[1] != NULL && planes[2] != NULL);
+        assert(n >= 0 && (depth == 1 || depth == 2));
+
+        kernels()->merge(planes, rgb, n, depth);
+}
+
+/********** A2Kernel_parse ********
+ *
+ * Converts n pixels of a binary (P6) PPM raster, three 8-bit samples or
+ * three big endian 16-bit samples per pixel, into pixels of the layouts the
+ * rest of the program uses
+ *
+ * Parameters:
+ *      const void *raster:     the first sample of the first pixel
+ *      void *out:              where the first converted pixel goes
+ *      int n:                  the number of pixels
+ *      int depth:              1 or 2, the bytes in a raster sample
+ *      int size:               the bytes in a converted pixel: 3 * depth to
+ *                              copy the raster as it is, 4 (depth 1) or 8
+ *                              (depth 2) for the pixels of A2Kernel_pack, or
+ *                              12 for a struct Pnm_rgb
+ *
+ * Return: n/a
+ *
+ * Expects: raster and out to not be NULL or overlap, n to be non-negative
+ *          and depth and size to be one of the combinations listed
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Kernel_parse(const void *raster, void *out, int n, int depth, int size)
+{
+        assert(raster != NULL && out != NULL);
+        assert(n >= 0 && (depth == 1 || depth == 2));
+        assert(size == 3 * depth || size == 4 * depth || size == 12);
+
+        kernels()->parse(raster, out, n, depth, size);
+}
+
+/********** A2Kernel_format ********
+ *
+ * Converts n pixels of the layouts A2Kernel_parse produces back into a
+ * binary (P6) PPM raster
+ *
+ * Parameters:
+ *      const void *in:         the first pixel
+ *      void *raster:           where the first sample of the first pixel
+ *                              goes
+ *      int n:                  the number of pixels
+ *      int depth:              1 or 2, the bytes in a raster sample
+ *      int size:               the bytes in a pixel, as for A2Kernel_parse
+ *
+ * Return: n/a
+ *
+ * Expects: in and raster to not be NULL or overlap, n to be non-negative,
+ *          depth and size to be a combination A2Kernel_parse accepts and
+ *          every channel to fit in a sample
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations, other than the channel range,
+ *        are violated
+ *
+ ************************/
+void A2Kernel_format(const void *in, void *raster, int n, int depth,
+                     int size)
+{
+        assert(in != NULL && raster != NULL);
+        assert(n >= 0 && (depth == 1 || depth == 2));
+        assert(size == 3 * depth || size == 4 * depth || size == 12);
+
+        kernels()->format(in, raster, n, depth, size);
+}
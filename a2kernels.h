@@ -0,0 +1,73 @@
+/**************************************************************
+ *
+ *                     a2kernels.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for the SIMD pixel kernels used by the A2
+ *              transform engine. Every kernel has a scalar version that
+ *              gives the same result on machines without the instructions
+ *              the fast versions need; which version runs is decided once
+ *              per process from CPUID and can be overridden.
+ *
+ **************************************************************/
+
+#ifndef A2KERNELS_INCLUDED
+#define A2KERNELS_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/* bind every kernel to one instruction set: "scalar", "sse4.2", "avx2" or
+ * "avx512"; false if unknown or unsupported by this processor. Kernels are
+ * otherwise bound to the best supported set on the first call; call this
+ * at startup, before other threads use them */
+extern bool A2Kernel_select(const char *isa);
+
+/* print the instruction set chosen for each kernel family */
+extern void A2Kernel_print(FILE *fp);
+
+/*
+ * transposes, or rotates by 90 or 270 degrees, an n x n square of 32-bit
+ * elements; strides are in elements and n must be a multiple of 8
+ */
+extern void A2Kernel_transpose32(const void *in, int inStride,
+                                 void *out, int outStride,
+                                 int n, int orientation);
+
+/*
+ * copies n elements of size bytes from in to out in reverse order; in and
+ * out must not overlap
+ */
+extern void A2Kernel_reverse(const void *in, void *out, int n, int size);
+
+/*
+ * packs n pixels of three unsigned channels (struct Pnm_rgb) into size 4
+ * (8-bit channels) or size 8 (16-bit channels) pixels with a zero pad
+ * channel, and back
+ */
+extern void A2Kernel_pack  (const void *rgb, void *out, int n, int size);
+extern void A2Kernel_unpack(const void *in, void *rgb, int n, int size);
+
+/*
+ * deinterleaves n pixels of three unsigned channels into red, green and blue
+ * planes of depth 1 (8-bit) or 2 (16-bit) samples, and back
+ */
+extern void A2Kernel_split(const void *rgb, void *const planes[3], int n,
+                           int depth);
+extern void A2Kernel_merge(const void *const planes[3], void *rgb, int n,
+                           int depth);
+
+/*
+ * converts n pixels of a P6 raster with samples of depth (1 or 2) bytes to
+ * pixels of size 3 * depth (a copy), 4 * depth (packed) or 12 (Pnm_rgb), and
+ * back
+ */
+extern void A2Kernel_parse (const void *raster, void *out, int n, int depth,
+                            int size);
+extern void A2Kernel_format(const void *in, void *raster, int n, int depth,
+                            int size);
+
+#endif
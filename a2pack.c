@@ -0,0 +1,203 @@
+/**************************************************************
+ *
+ *                     a2pack.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of packed pixel conversion. Plain arrays
+ *              are converted a whole row at a time by the vectorized pack
+ *              kernels; other arrays are converted one pixel at a time in the
+ *              order of their default map. Arrays of raw P6 raster pixels (3
+ *              or 6 bytes) can be made and unpacked too.
+ *
+ **************************************************************/
+
+#include <stdbool.h>
+
+#include "assert.h"
+#include "a2pack.h"
+#include "a2kernels.h"
+#include "a2plain.h"
+#include "uarray2.h"
+#include "pnm.h"
+
+typedef A2Methods_UArray2 A2;
+
+/*
+ * Struct to pass the array that is not being traversed into convertOne.
+ */
+struct convertCl {
+        A2Methods_T methods;    /* methods shared by both arrays */
+        A2 rgb;                 /* the array of Pnm_rgb pixels */
+        int size;               /* bytes per packed pixel */
+        bool packing;           /* true to pack, false to unpack */
+};
+
+/********** A2_packed_size ********
+ *
+ * Finds the smallest packed pixel that holds every channel of an image
+ *
+ * Parameters:
+ *      unsigned denominator:   the maxval of the image
+ *
+ * Return: 4 for a maxval up to 255, otherwise 8
+ *
+ * Expects: denominator to be between 1 and 65535, as the PNM format allows
+ *
+ * Notes:
+ *      - Calls CRE if denominator is out of range
+ *
+ ************************/
+int A2_packed_size(unsigned denominator)
+{
+        assert(denominator > 0 && denominator <= 65535);
+
+        return denominator <= 255 ? 4 : 8;
+}
+
+/********** convertOne ********
+ *
+ * Apply function that packs or unpacks the pixel at (i, j) of the packed
+ * array
+ *
+ * Parameters:
+ *      int i, j:               column and row of the pixel
+ *      A2 packed:              the packed array being traversed
+ *      void *elem:             the packed pixel
+ *      void *cl:               a struct convertCl
+ *
+ * Return: n/a
+ *
+ ************************/
+static void convertOne(int i, int j, A2 packed, void *elem, void *cl)
+{
+        struct convertCl *bundle = cl;
+        void *rgb = bundle->methods->at(bundle->rgb, i, j);
+        (void) packed;
+
+        if (bundle->packing && bundle->size % 3 == 0) {
+                A2Kernel_format(rgb, elem, 1, bundle->size / 3,
+                                                    sizeof(struct Pnm_rgb));
+        } else if (bundle->packing) {
+                A2Kernel_pack(rgb, elem, 1, bundle->size);
+        } else if (bundle->size % 3 == 0) {
+                A2Kernel_parse(elem, rgb, 1, bundle->size / 3,
+                                                    sizeof(struct Pnm_rgb));
+        } else {
+                A2Kernel_unpack(elem, rgb, 1, bundle->size);
+        }
+}
+
+/********** convert ********
+ *
+ * Packs every pixel of rgb into packed or unpacks every pixel of packed into
+ * rgb
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both arrays
+ *      A2 rgb:                 the array of Pnm_rgb pixels
+ *      A2 packed:              the array of packed pixels
+ *      bool packing:           true to pack, false to unpack
+ *
+ * Return: n/a
+ *
+ ************************/
+static void convert(A2Methods_T methods, A2 rgb, A2 packed, bool packing)
+{
+        int width = methods->width(packed);
+        int height = methods->height(packed);
+        int size = methods->size(packed);
+
+        if (methods == uarray2_methods_plain) {
+                if (width == 0) {
+                        return;
+                }
+                for (int r = 0; r < height; r++) {
+                        void *pixels = UArray2_row(rgb, r);
+                        void *row = UArray2_row(packed, r);
+                        if (packing && size % 3 == 0) {
+                                A2Kernel_format(pixels, row, width, size / 3,
+                                                    sizeof(struct Pnm_rgb));
+                        } else if (packing) {
+                                A2Kernel_pack(pixels, row, width, size);
+                        } else if (size % 3 == 0) {
+                                A2Kernel_parse(row, pixels, width, size / 3,
+                                                    sizeof(struct Pnm_rgb));
+                        } else {
+                                A2Kernel_unpack(row, pixels, width, size);
+                        }
+                }
+        } else {
+                struct convertCl bundle = { methods, rgb, size, packing };
+                methods->map_default(packed, convertOne, &bundle);
+        }
+}
+
+/********** A2_pack ********
+ *
+ * Makes a packed copy of an array of Pnm_rgb pixels
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for pixels and the new array
+ *      A2 pixels:              the array of Pnm_rgb pixels
+ *      int size:               4 or 8, usually from A2_packed_size, or 3
+ *                              or 6 for pixels laid out as in a P6 raster
+ *
+ * Return: a new array of the same width and height with elements of size
+ *         bytes, which the caller frees with methods->free
+ *
+ * Expects: methods and pixels to not be NULL, pixels to hold Pnm_rgb
+ *          elements, size to be 3, 4, 6 or 8 and every channel to fit in
+ *          the packed pixel
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations, other than the channel range,
+ *        are violated
+ *
+ ************************/
+A2 A2_pack(A2Methods_T methods, A2 pixels, int size)
+{
+        assert(methods != NULL && pixels != NULL);
+        assert(methods->size(pixels) == sizeof(struct Pnm_rgb));
+        assert(size == 3 || size == 4 || size == 6 || size == 8);
+
+        A2 packed = methods->new(methods->width(pixels),
+                                 methods->height(pixels), size);
+        convert(methods, pixels, packed, true);
+        return packed;
+}
+
+/********** A2_unpack ********
+ *
+ * Makes an array of Pnm_rgb pixels from a packed array
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for packed and the new array
+ *      A2 packed:              an array made by A2_pack, or an array of 3 or
+ *                              6 byte pixels laid out as in a P6 raster,
+ *                              possibly transformed since
+ *
+ * Return: a new array of the same width and height with Pnm_rgb elements,
+ *         which the caller frees with methods->free
+ *
+ * Expects: methods and packed to not be NULL and packed to have elements of
+ *          3, 4, 6 or 8 bytes
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+A2 A2_unpack(A2Methods_T methods, A2 packed)
+{
+        assert(methods != NULL && packed != NULL);
+        int size = methods->size(packed);
+        assert(size == 3 || size == 4 || size == 6 || size == 8);
+
+        A2 pixels = methods->new(methods->width(packed),
+                                 methods->height(packed),
+                                 sizeof(struct Pnm_rgb));
+        convert(methods, pixels, packed, false);
+        return pixels;
+}
@@ -0,0 +1,35 @@
+/**************************************************************
+ *
+ *                     a2pack.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for converting A2 arrays of struct Pnm_rgb
+ *              pixels (three unsigned channels, 12 bytes) to and from
+ *              compact packed pixels of 4 bytes (maxval up to 255) or 8
+ *              bytes (maxval up to 65535), so transforms move a third or two
+ *              thirds of the bytes.
+ *
+ **************************************************************/
+
+#ifndef A2PACK_INCLUDED
+#define A2PACK_INCLUDED
+
+#include "a2methods.h"
+
+/* bytes in a packed pixel holding channels up to denominator: 4 or 8 */
+extern int A2_packed_size(unsigned denominator);
+
+/* new array of the same shape holding every Pnm_rgb pixel packed; 3 and 6
+ * byte pixels are laid out as in a P6 raster */
+extern A2Methods_UArray2 A2_pack(A2Methods_T methods,
+                                 A2Methods_UArray2 pixels, int size);
+
+/* new array of Pnm_rgb pixels holding every packed pixel widened; 3 and 6
+ * byte pixels are taken to be laid out as in a P6 raster */
+extern A2Methods_UArray2 A2_unpack(A2Methods_T methods,
+                                   A2Methods_UArray2 packed);
+
+#endif
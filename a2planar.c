@@ -0,0 +1,446 @@
+/**************************************************************
+ *
+ *                     a2planar.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of planar RGB images. The three planes
+ *              share one set of A2 methods; plain planes are converted to
+ *              and from Pnm_rgb a whole row at a time by the split and merge
+ *              kernels, other planes one pixel at a time. A2Methods itself
+ *              cannot describe a planar image, because its at function
+ *              must return the address of one element holding the whole
+ *              pixel, so the planes are exposed as three ordinary A2 arrays
+ *              instead.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "assert.h"
+#include "a2planar.h"
+#include "a2transform.h"
+#include "a2kernels.h"
+#include "a2plain.h"
+#include "uarray2.h"
+#include "pnm.h"
+
+#define T A2Planar_T
+
+typedef A2Methods_UArray2 A2;
+
+struct T {
+        A2Methods_T methods;    /* methods of every plane */
+        int width;
+        int height;
+        int depth;              /* bytes per sample, 1 or 2 */
+        A2 planes[3];           /* red, green and blue */
+};
+
+/*
+ * Struct to pass the image being converted into the per pixel apply
+ * functions.
+ */
+struct convertCl {
+        T planar;
+        A2 rgb;                 /* the Pnm_rgb array not being traversed */
+};
+
+/*
+ * Struct to pass the counters of a histogram into countOne.
+ */
+struct countCl {
+        unsigned *counts;
+        int depth;              /* bytes per sample */
+};
+
+/********** A2Planar_new ********
+ *
+ * Creates a planar image with every sample zero
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods used to make each plane
+ *      int width:              the number of columns
+ *      int height:             the number of rows
+ *      int depth:              bytes per sample: 1 for a maxval up to 255, 2
+ *                              for a maxval up to 65535
+ *
+ * Return: the new image, which the caller frees with A2Planar_free
+ *
+ * Expects: methods to not be NULL, width and height to be non-negative and
+ *          depth to be 1 or 2
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *        be allocated
+ *
+ ************************/
+T A2Planar_new(A2Methods_T methods, int width, int height, int depth)
+{
+        assert(methods != NULL);
+        assert(width >= 0 && height >= 0);
+        assert(depth == 1 || depth == 2);
+
+        T planar = malloc(sizeof(*planar));
+        assert(planar != NULL);
+
+        planar->methods = methods;
+        planar->width = width;
+        planar->height = height;
+        planar->depth = depth;
+        for (int c = 0; c < 3; c++) {
+                planar->planes[c] = methods->new(width, height, depth);
+        }
+        return planar;
+}
+
+/********** A2Planar_free ********
+ *
+ * Frees a planar image and its planes
+ *
+ * Parameters:
+ *      T *planar:      a pointer to the image, set to NULL afterwards
+ *
+ * Return: n/a
+ *
+ * Expects: planar and *planar to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if planar or *planar is NULL
+ *
+ ************************/
+void A2Planar_free(T *planar)
+{
+        assert(planar != NULL && *planar != NULL);
+
+        for (int c = 0; c < 3; c++) {
+                (*planar)->methods->free(&((*planar)->planes[c]));
+        }
+        free(*planar);
+        *planar = NULL;
+}
+
+/********** A2Planar_width, A2Planar_height, A2Planar_depth ********
+ *
+ * Get the number of columns, the number of rows and the bytes per sample of
+ * a planar image
+ *
+ * Parameters:
+ *      T planar:       the image
+ *
+ * Return: the requested dimension
+ *
+ * Expects: planar to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if planar is NULL
+ *
+ ************************/
+int A2Planar_width(T planar)
+{
+        assert(planar != NULL);
+        return planar->width;
+}
+
+int A2Planar_height(T planar)
+{
+        assert(planar != NULL);
+        return planar->height;
+}
+
+int A2Planar_depth(T planar)
+{
+        assert(planar != NULL);
+        return planar->depth;
+}
+
+/********** A2Planar_plane ********
+ *
+ * Gets the plane of one channel, an A2 array of samples that works with the
+ * methods the image was made with
+ *
+ * Parameters:
+ *      T planar:       the image
+ *      int channel:    0 for red, 1 for green, 2 for blue
+ *
+ * Return: the plane, still owned by the image
+ *
+ * Expects: planar to not be NULL and channel to be 0, 1 or 2
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+A2 A2Planar_plane(T planar, int channel)
+{
+        assert(planar != NULL);
+        assert(channel >= 0 && channel < 3);
+        return planar->planes[channel];
+}
+
+/********** splitOne ********
+ *
+ * Apply function that copies the channels of the Pnm_rgb pixel at (i, j)
+ * into the three planes
+ *
+ * Parameters:
+ *      int i, j:               column and row of the pixel
+ *      A2 rgb:                 the Pnm_rgb array being traversed
+ *      void *elem:             the pixel
+ *      void *cl:               a struct convertCl
+ *
+ * Return: n/a
+ *
+ ************************/
+static void splitOne(int i, int j, A2 rgb, void *elem, void *cl)
+{
+        struct convertCl *bundle = cl;
+        T planar = bundle->planar;
+        void *samples[3];
+        (void) rgb;
+
+        for (int c = 0; c < 3; c++) {
+                samples[c] = planar->methods->at(planar->planes[c], i, j);
+        }
+        A2Kernel_split(elem, samples, 1, planar->depth);
+}
+
+/********** mergeOne ********
+ *
+ * Apply function that copies the three samples at (i, j) into the Pnm_rgb
+ * pixel at (i, j)
+ *
+ * Parameters: the same as splitOne
+ *
+ * Return: n/a
+ *
+ ************************/
+static void mergeOne(int i, int j, A2 rgb, void *elem, void *cl)
+{
+        struct convertCl *bundle = cl;
+        T planar = bundle->planar;
+        const void *samples[3];
+        (void) rgb;
+
+        for (int c = 0; c < 3; c++) {
+                samples[c] = planar->methods->at(planar->planes[c], i, j);
+        }
+        A2Kernel_merge(samples, elem, 1, planar->depth);
+}
+
+/********** A2Planar_from_rgb ********
+ *
+ * Makes a planar copy of an array of Pnm_rgb pixels
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for pixels and the planes
+ *      A2 pixels:              the array of Pnm_rgb pixels
+ *      unsigned denominator:   the maxval of the image, which picks 8-bit or
+ *                              16-bit samples
+ *
+ * Return: the new image, which the caller frees with A2Planar_free
+ *
+ * Expects: methods and pixels to not be NULL, pixels to hold Pnm_rgb
+ *          elements and denominator to be between 1 and 65535
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+T A2Planar_from_rgb(A2Methods_T methods, A2 pixels, unsigned denominator)
+{
+        assert(methods != NULL && pixels != NULL);
+        assert(methods->size(pixels) == sizeof(struct Pnm_rgb));
+        assert(denominator > 0 && denominator <= 65535);
+
+        int width = methods->width(pixels);
+        int height = methods->height(pixels);
+        T planar = A2Planar_new(methods, width, height,
+                                denominator <= 255 ? 1 : 2);
+
+        if (methods == uarray2_methods_plain) {
+                for (int r = 0; r < height && width > 0; r++) {
+                        void *rows[3];
+                        for (int c = 0; c < 3; c++) {
+                                rows[c] = UArray2_row(planar->planes[c], r);
+                        }
+                        A2Kernel_split(UArray2_row(pixels, r), rows, width,
+                                                               planar->depth);
+                }
+        } else {
+                struct convertCl bundle = { planar, pixels };
+                methods->map_default(pixels, splitOne, &bundle);
+        }
+        return planar;
+}
+
+/********** A2Planar_to_rgb ********
+ *
+ * Makes an array of Pnm_rgb pixels from a planar image
+ *
+ * Parameters:
+ *      T planar:       the image
+ *
+ * Return: a new array, made with the image's methods, which the caller frees
+ *         with methods->free
+ *
+ * Expects: planar to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if planar is NULL
+ *
+ ************************/
+A2 A2Planar_to_rgb(T planar)
+{
+        assert(planar != NULL);
+
+        A2Methods_T methods = planar->methods;
+        int width = planar->width;
+        int height = planar->height;
+        A2 pixels = methods->new(width, height, sizeof(struct Pnm_rgb));
+
+        if (methods == uarray2_methods_plain) {
+                for (int r = 0; r < height && width > 0; r++) {
+                        const void *rows[3];
+                        for (int c = 0; c < 3; c++) {
+                                rows[c] = UArray2_row(planar->planes[c], r);
+                        }
+                        A2Kernel_merge(rows, UArray2_row(pixels, r), width,
+                                                               planar->depth);
+                }
+        } else {
+                struct convertCl bundle = { planar, pixels };
+                methods->map_default(pixels, mergeOne, &bundle);
+        }
+        return pixels;
+}
+
+/********** A2Planar_transform ********
+ *
+ * Rotates, flips or transposes every plane of src into the same plane of
+ * dst; each plane goes through the same index mapping as a whole image
+ * would, with elements of only one or two bytes
+ *
+ * Parameters:
+ *      T src:                  the image being transformed
+ *      T dst:                  the image receiving the result, with the
+ *                              transformed shape
+ *      A2Methods_mapfun *map:  the map scattering and gathering traverse
+ *      int orientation:        one of the A2_* orientation codes
+ *      int direction:          A2_SCATTER, A2_GATHER, A2_TILED, or -1 to let
+ *                              A2_plan_direction choose
+ *
+ * Return: n/a
+ *
+ * Expects: src, dst and map to not be NULL, both images to share methods and
+ *          depth, and the expectations of A2_transform on every plane
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Planar_transform(T src, T dst, A2Methods_mapfun *map, int orientation,
+                        int direction)
+{
+        assert(src != NULL && dst != NULL && map != NULL);
+        assert(src->methods == dst->methods);
+        assert(src->depth == dst->depth);
+
+        A2Methods_T methods = src->methods;
+        if (direction < 0) {
+                direction = A2_plan_direction(methods, map, orientation);
+        }
+        for (int c = 0; c < 3; c++) {
+                if (direction == A2_GATHER) {
+                        A2_transform_gather(methods, map, src->planes[c],
+                                            dst->planes[c], orientation);
+                } else if (direction == A2_TILED) {
+                        A2_transform_tiled(methods, src->planes[c],
+                                           dst->planes[c], orientation, 0);
+                } else {
+                        A2_transform(methods, map, src->planes[c],
+                                     dst->planes[c], orientation);
+                }
+        }
+}
+
+/********** countOne ********
+ *
+ * Apply function that counts one sample of a plane
+ *
+ * Parameters:
+ *      int i, j:               column and row of the sample (unused)
+ *      A2 plane:               the plane being traversed
+ *      void *elem:             the sample
+ *      void *cl:               a struct countCl
+ *
+ * Return: n/a
+ *
+ ************************/
+static void countOne(int i, int j, A2 plane, void *elem, void *cl)
+{
+        struct countCl *bundle = cl;
+        (void) i;
+        (void) j;
+        (void) plane;
+
+        if (bundle->depth == 1) {
+                bundle->counts[*(uint8_t *) elem]++;
+        } else {
+                bundle->counts[*(uint16_t *) elem]++;
+        }
+}
+
+/********** A2Planar_histogram ********
+ *
+ * Counts how often every sample value occurs in one channel. Only that
+ * channel's plane is read, as contiguous rows when the planes are plain.
+ *
+ * Parameters:
+ *      T planar:               the image
+ *      int channel:            0 for red, 1 for green, 2 for blue
+ *      unsigned *counts:       256 counters for 8-bit samples, 65536 for
+ *                              16-bit samples; they are overwritten
+ *
+ * Return: n/a
+ *
+ * Expects: planar and counts to not be NULL and channel to be 0, 1 or 2
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void A2Planar_histogram(T planar, int channel, unsigned *counts)
+{
+        assert(planar != NULL && counts != NULL);
+        assert(channel >= 0 && channel < 3);
+
+        A2 plane = planar->planes[channel];
+        memset(counts, 0, sizeof(*counts) << (8 * planar->depth));
+
+        if (planar->methods == uarray2_methods_plain) {
+                for (int r = 0; r < planar->height && planar->width > 0;
+                                                                      r++) {
+                        if (planar->depth == 1) {
+                                const uint8_t *row = UArray2_row(plane, r);
+                                for (int k = 0; k < planar->width; k++) {
+                                        counts[row[k]]++;
+                                }
+                        } else {
+                                const uint16_t *row = UArray2_row(plane, r);
+                                for (int k = 0; k < planar->width; k++) {
+                                        counts[row[k]]++;
+                                }
+                        }
+                }
+        } else {
+                struct countCl bundle = { counts, planar->depth };
+                planar->methods->map_default(plane, countOne, &bundle);
+        }
+}
+
+#undef T
@@ -0,0 +1,54 @@
+/**************************************************************
+ *
+ *                     a2planar.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for planar (structure of arrays) RGB images:
+ *              the red, green and blue samples live in three separate A2
+ *              arrays of 8-bit or 16-bit samples, each plain or blocked
+ *              depending on the methods it was made with. Transforms run
+ *              once per plane and per channel work touches only its own
+ *              plane.
+ *
+ **************************************************************/
+
+#ifndef A2PLANAR_INCLUDED
+#define A2PLANAR_INCLUDED
+
+#include "a2methods.h"
+
+#define T A2Planar_T
+typedef struct T *T;
+
+/* new image of three planes with samples of depth (1 or 2) bytes */
+extern T    A2Planar_new (A2Methods_T methods, int width, int height,
+                          int depth);
+extern void A2Planar_free(T *planar);
+
+extern int  A2Planar_width (T planar);
+extern int  A2Planar_height(T planar);
+extern int  A2Planar_depth (T planar);
+
+/* the plane of channel 0 (red), 1 (green) or 2 (blue) */
+extern A2Methods_UArray2 A2Planar_plane(T planar, int channel);
+
+/* deinterleave an array of Pnm_rgb pixels whose maxval is denominator */
+extern T    A2Planar_from_rgb(A2Methods_T methods, A2Methods_UArray2 pixels,
+                              unsigned denominator);
+
+/* new array of Pnm_rgb pixels interleaving the three planes */
+extern A2Methods_UArray2 A2Planar_to_rgb(T planar);
+
+/* transforms every plane of src into dst with the map and direction (an
+ * A2_* direction, or -1 to let A2_plan_direction choose) of A2_transform */
+extern void A2Planar_transform(T src, T dst, A2Methods_mapfun *map,
+                               int orientation, int direction);
+
+/* counts[v] = number of samples of value v in one channel */
+extern void A2Planar_histogram(T planar, int channel, unsigned *counts);
+
+#undef T
+#endif
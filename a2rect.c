@@ -0,0 +1,205 @@
+/**************************************************************
+ *
+ *                     a2rect.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: A subclass for A2Methods_T virtual class backed by UArray2b
+ *              arrays with rectangular blocks, optionally divided into
+ *              tiles. Everything but making arrays is as in the blocked
+ *              suite; the block and tile shapes are settings of the suite,
+ *              since A2Methods_T new takes no shape.
+ *
+ **************************************************************/
+
+#include "assert.h"
+#include "a2rect.h"
+#include "a2blocked.h"
+#include "uarray2b.h"
+
+typedef A2Methods_UArray2 A2;   /* private abbreviation */
+
+#define SHAPE_WIDTH 128         /* the block shape until one is set */
+#define SHAPE_HEIGHT 32
+
+/* the block and tile shapes new uses, see A2_set_block_shape and
+ * A2_set_tile_shape; tiles the size of the block mean no tiles */
+static int shapeWidth = SHAPE_WIDTH;
+static int shapeHeight = SHAPE_HEIGHT;
+static int tileWidth = SHAPE_WIDTH;
+static int tileHeight = SHAPE_HEIGHT;
+
+static A2 new(int width, int height, int size)
+{
+        return UArray2b_new_tiled(width, height, size, shapeWidth,
+                                  shapeHeight, tileWidth, tileHeight);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+        if (tileWidth == shapeWidth && tileHeight == shapeHeight) {
+                int bw = (int) ((long long) blocksize * shapeWidth /
+                                shapeHeight);
+                return UArray2b_new_rect(width, height, size,
+                                         bw > 0 ? bw : 1, blocksize);
+        }
+
+        /* keeps the tiles, with as many as make blocks closest to the
+         * shape's aspect and blocksize high */
+        int across = shapeWidth / tileWidth;
+        int down = shapeHeight / tileHeight;
+        int high = (blocksize + tileHeight / 2) / tileHeight;
+        high = high > 0 ? high : 1;
+        int wide = (int) (((long long) high * across + down / 2) / down);
+        wide = wide > 0 ? wide : 1;
+        return UArray2b_new_tiled(width, height, size, wide * tileWidth,
+                                  high * tileHeight, tileWidth, tileHeight);
+}
+
+static void a2free(A2 *array2p)
+{
+        UArray2b_free((UArray2b_T *) array2p);
+}
+
+static int width(A2 array2)
+{
+        return UArray2b_width(array2);
+}
+
+static int height(A2 array2)
+{
+        return UArray2b_height(array2);
+}
+
+static int size(A2 array2)
+{
+        return UArray2b_size(array2);
+}
+
+static int blocksize(A2 array2)
+{
+        return UArray2b_blocksize(array2);
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j)
+{
+        return UArray2b_at(array2, i, j);
+}
+
+typedef void applyfun(int i, int j, UArray2b_T array2b, void *elem, void *cl);
+
+static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        UArray2b_map(array2, (applyfun *) apply, cl);
+}
+
+struct small_closure {
+        A2Methods_smallapplyfun *apply;
+        void *cl;
+};
+
+static void apply_small(int i, int j, UArray2b_T array2, void *elem,
+                        void *vcl)
+{
+        struct small_closure *cl = vcl;
+        (void) i;
+        (void) j;
+        (void) array2;
+        cl->apply(elem, cl->cl);
+}
+
+static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply,
+                                  void *cl)
+{
+        struct small_closure mycl = { apply, cl };
+        UArray2b_map(a2, apply_small, &mycl);
+}
+
+static struct A2Methods_T uarray2_methods_blocked_rect_struct = {
+        new,
+        new_with_blocksize,
+        a2free,
+        width,
+        height,
+        size,
+        blocksize,
+        at,
+        NULL,                   /* map_row_major */
+        NULL,                   /* map_col_major */
+        map_block_major,
+        map_block_major,        /* map_default */
+        NULL,                   /* small_map_row_major */
+        NULL,                   /* small_map_col_major */
+        small_map_block_major,
+        small_map_block_major,  /* small_map_default */
+};
+
+A2Methods_T uarray2_methods_blocked_rect = &uarray2_methods_blocked_rect_struct;
+
+/********** A2_set_block_shape ********
+ *
+ * Sets the shape of the blocks of arrays uarray2_methods_blocked_rect makes
+ * and stops dividing them into tiles
+ *
+ * Parameters:
+ *      int bw, bh:             the columns and rows in a block
+ *
+ * Return: n/a
+ *
+ * Expects: bw and bh to be positive with bw * bh cells fitting in an int
+ *
+ * Notes:
+ *      - Calls CRE if the expectations are violated
+ *      - Arrays already made keep their shape
+ *
+ ************************/
+void A2_set_block_shape(int bw, int bh)
+{
+        assert(bw > 0 && bh > 0 && bw <= 2147483647 / bh);
+        shapeWidth = bw;
+        shapeHeight = bh;
+        tileWidth = bw;
+        tileHeight = bh;
+}
+
+/********** A2_set_tile_shape ********
+ *
+ * Divides the blocks of arrays uarray2_methods_blocked_rect makes into tiles
+ *
+ * Parameters:
+ *      int tw, th:             the columns and rows in a tile
+ *
+ * Return: n/a
+ *
+ * Expects: tw and th to be positive and to divide the width and height of
+ *          the block shape last set
+ *
+ * Notes:
+ *      - Calls CRE if the expectations are violated
+ *
+ ************************/
+void A2_set_tile_shape(int tw, int th)
+{
+        assert(tw > 0 && th > 0);
+        assert(shapeWidth % tw == 0 && shapeHeight % th == 0);
+        tileWidth = tw;
+        tileHeight = th;
+}
+
+/********** A2_is_blocked ********
+ *
+ * Tells whether a methods suite makes UArray2b arrays
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the suite
+ *
+ * Return: true for the blocked suite and this one
+ *
+ ************************/
+bool A2_is_blocked(A2Methods_T methods)
+{
+        return methods == uarray2_methods_blocked ||
+               methods == uarray2_methods_blocked_rect;
+}
@@ -0,0 +1,39 @@
+/**************************************************************
+ *
+ *                     a2rect.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The A2Methods suite for blocked arrays with rectangular
+ *              blocks (UArray2b_new_rect), optionally divided into tiles
+ *              (UArray2b_new_tiled). Its arrays are UArray2b arrays, mapped
+ *              block-major only like the blocked suite, with blocks and
+ *              tiles of the shapes last set by A2_set_block_shape and
+ *              A2_set_tile_shape.
+ *
+ **************************************************************/
+
+#ifndef A2RECT_INCLUDED
+#define A2RECT_INCLUDED
+
+#include <stdbool.h>
+#include "a2methods.h"
+
+extern A2Methods_T uarray2_methods_blocked_rect;
+
+/* blocks of arrays made by uarray2_methods_blocked_rect->new from now on
+ * are bw columns by bh rows; new_with_blocksize keeps the shape's aspect
+ * with blocks blocksize rows high */
+extern void A2_set_block_shape(int bw, int bh);
+
+/* blocks made from now on are divided into tiles of tw columns by th rows,
+ * which must divide the block shape; setting the block shape again turns
+ * tiles off */
+extern void A2_set_tile_shape(int tw, int th);
+
+/* true if the arrays of methods are UArray2b_T (the blocked suites) */
+extern bool A2_is_blocked(A2Methods_T methods);
+
+#endif
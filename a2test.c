@@ -1,9 +1,21 @@
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include "assert.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "uarray2b.h"
+#include "a2kernels.h"
+#include "a2transform.h"
+#include "a2rect.h"
+#include "a2compressed.h"
+#include "a2alloc.h"
+#include "uarray2bz.h"
+#include "ppmio.h"
+#include "pnm.h"
 
 
 #define W 20
@@ -173,12 +185,868 @@ static void test_methods(A2Methods_T methods_under_test)
         methods->free(&array);
 }
 
+/* the value fill_blocked stores at column i, row j */
+static inline unsigned filled(int i, int j)
+{
+        return 1000 * i + j;
+}
+
+static void fill_blocked(UArray2b_T array)
+{
+        for (int i = 0; i < UArray2b_width(array); i++) {
+                for (int j = 0; j < UArray2b_height(array); j++) {
+                        unsigned *p = UArray2b_at(array, i, j);
+                        *p = filled(i, j);
+                }
+        }
+}
+
+static inline unsigned get_blocked(UArray2b_T array, int i, int j)
+{
+        return *(const unsigned *) UArray2b_get(array, i, j);
+}
+
+/* true if every cell but (skip_i, skip_j) holds what fill_blocked stored */
+static bool holds_fill(UArray2b_T array, int skip_i, int skip_j)
+{
+        for (int i = 0; i < UArray2b_width(array); i++) {
+                for (int j = 0; j < UArray2b_height(array); j++) {
+                        if ((i != skip_i || j != skip_j) &&
+                            get_blocked(array, i, j) != filled(i, j)) {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+static void save_load_round_trip(UArray2b_T array)
+{
+        fill_blocked(array);
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        UArray2b_save(array, fp, 255);
+
+        unsigned tag = 0;
+        UArray2b_T loaded = UArray2b_load(fp, &tag);
+        assert(loaded != NULL && tag == 255);
+        assert(UArray2b_width(loaded) == UArray2b_width(array));
+        assert(UArray2b_height(loaded) == UArray2b_height(array));
+        assert(UArray2b_size(loaded) == UArray2b_size(array));
+        assert(UArray2b_block_width(loaded) == UArray2b_block_width(array));
+        assert(UArray2b_block_height(loaded) ==
+               UArray2b_block_height(array));
+        assert(UArray2b_tile_width(loaded) == UArray2b_tile_width(array));
+        assert(UArray2b_tile_height(loaded) == UArray2b_tile_height(array));
+        assert(holds_fill(loaded, -1, -1));
+
+        /* writes change the private mapping, never the file */
+        unsigned *p = UArray2b_at(loaded, 1, 1);
+        *p = 5;
+        UArray2b_T again = UArray2b_load(fp, NULL);
+        assert(again != NULL && holds_fill(again, -1, -1));
+        assert(get_blocked(loaded, 1, 1) == 5);
+
+        UArray2b_free(&again);
+        UArray2b_free(&loaded);
+        UArray2b_free(&array);
+        fclose(fp);
+}
+
+static void test_save_load(void)
+{
+        save_load_round_trip(UArray2b_new(W, H, sizeof(unsigned), BS));
+        save_load_round_trip(UArray2b_new_rect(W, H, sizeof(unsigned), 7,
+                                               3));
+        save_load_round_trip(UArray2b_new_tiled(W, H, sizeof(unsigned), 8,
+                                                6, 4, 3));
+
+        /* a file that is not a saved array is refused and left unread */
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        fputs("P6\n64 64\n255\n", fp);
+        for (int k = 0; k < 64 * 64 * 3; k++) {
+                fputc(k & 0xff, fp);
+        }
+        rewind(fp);
+        assert(UArray2b_load(fp, NULL) == NULL);
+        assert(ftell(fp) == 0 && fgetc(fp) == 'P');
+        fclose(fp);
+}
+
+static void test_constant_blocks(void)
+{
+        UArray2b_T array = UArray2b_new(W, H, sizeof(unsigned), BS);
+        const unsigned *value = UArray2b_constant(array, 0, 0);
+        assert(value != NULL && *value == 0);
+
+        /* fill_block stores one value; get reads it without copying */
+        unsigned seven = 7;
+        UArray2b_fill_block(array, 5, 5, &seven);
+        value = UArray2b_constant(array, BS, BS);
+        assert(value != NULL && *value == 7);
+        assert(get_blocked(array, 2 * BS - 1, 2 * BS - 1) == 7);
+        assert(UArray2b_constant(array, BS, BS) != NULL);
+
+        /* at materializes the block with every cell holding the value */
+        unsigned *p = UArray2b_at(array, 6, 5);
+        assert(UArray2b_constant(array, BS, BS) == NULL);
+        for (int i = BS; i < 2 * BS; i++) {
+                for (int j = BS; j < 2 * BS; j++) {
+                        assert(get_blocked(array, i, j) == 7);
+                }
+        }
+        *p = 8;
+        assert(get_blocked(array, 6, 5) == 8);
+        assert(get_blocked(array, BS, BS) == 7);
+
+        /* dedup finds blocks holding one value again, edge blocks too */
+        *p = 7;
+        UArray2b_dedup(array);
+        value = UArray2b_constant(array, BS, BS);
+        assert(value != NULL && *value == 7);
+
+        fill_blocked(array);
+        for (int i = (W - 1) / BS * BS; i < W; i++) {
+                for (int j = (H - 1) / BS * BS; j < H; j++) {
+                        p = UArray2b_at(array, i, j);
+                        *p = 3;
+                }
+        }
+        UArray2b_dedup(array);
+        assert(UArray2b_constant(array, BS, BS) == NULL);
+        value = UArray2b_constant(array, W - 1, H - 1);
+        assert(value != NULL && *value == 3);
+        assert(get_blocked(array, 0, 0) == filled(0, 0));
+        assert(get_blocked(array, W - 1, 0) == filled(W - 1, 0));
+
+        UArray2b_free(&array);
+}
+
+static void test_clones(void)
+{
+        UArray2b_T array = UArray2b_new(W, H, sizeof(unsigned), BS);
+        fill_blocked(array);
+        UArray2b_T clone = UArray2b_clone(array);
+        assert(holds_fill(clone, -1, -1));
+
+        /* a write to either side leaves the other unchanged */
+        unsigned *p = UArray2b_at(clone, 3, 2);
+        *p = 1;
+        assert(holds_fill(array, -1, -1));
+        p = UArray2b_at(array, 9, 9);
+        *p = 2;
+        assert(holds_fill(clone, 3, 2));
+        assert(get_blocked(clone, 9, 9) == filled(9, 9));
+
+        /* the original can be freed before its clone */
+        UArray2b_free(&array);
+        assert(holds_fill(clone, 3, 2));
+        assert(get_blocked(clone, 3, 2) == 1);
+        UArray2b_free(&clone);
+
+        /* a clone of a loaded array outlives the original's mapping */
+        array = UArray2b_new_tiled(W, H, sizeof(unsigned), 8, 6, 4, 3);
+        fill_blocked(array);
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        UArray2b_save(array, fp, 0);
+        UArray2b_free(&array);
+        UArray2b_T loaded = UArray2b_load(fp, NULL);
+        assert(loaded != NULL);
+        fclose(fp);
+
+        clone = UArray2b_clone(loaded);
+        p = UArray2b_at(clone, 2, 2);
+        *p = 0;
+        assert(holds_fill(loaded, -1, -1));
+        UArray2b_free(&loaded);
+        assert(holds_fill(clone, 2, 2));
+        assert(get_blocked(clone, 2, 2) == 0);
+        UArray2b_free(&clone);
+}
+
+struct visit_closure {
+        int how;        /* how the first column of blocks is visited */
+        unsigned sum;
+};
+
+/* visits the blocks of the first block column as cl says, skips the
+ * others */
+static int visit_first_column(int col, int row, UArray2b_T array, void *cl)
+{
+        (void) row;
+        (void) array;
+        return col == 0 ? ((struct visit_closure *) cl)->how : UArray2b_SKIP;
+}
+
+static void store_filled(int col, int row, UArray2b_T array, void *elem,
+                         void *cl)
+{
+        (void) array;
+        (void) cl;
+        *(unsigned *) elem = filled(col, row);
+}
+
+static void sum_cells(int col, int row, UArray2b_T array, void *elem,
+                      void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) array;
+        ((struct visit_closure *) cl)->sum += *(unsigned *) elem;
+}
+
+static void test_map_blocks(void)
+{
+        UArray2b_T array = UArray2b_new(W, H, sizeof(unsigned), BS);
+        struct visit_closure visit = { UArray2b_WRITE, 0 };
+        UArray2b_map_blocks(array, visit_first_column, store_filled, &visit);
+        for (int j = 0; j < H; j += BS) {
+                assert(UArray2b_constant(array, 0, j) == NULL);
+                assert(UArray2b_constant(array, BS, j) != NULL);
+        }
+        for (int i = 0; i < W; i++) {
+                for (int j = 0; j < H; j++) {
+                        assert(get_blocked(array, i, j) ==
+                               (i < BS ? filled(i, j) : 0));
+                }
+        }
+
+        /* reading a constant or shared block leaves it as it is */
+        unsigned seven = 7;
+        UArray2b_fill_block(array, 0, 0, &seven);
+        UArray2b_T clone = UArray2b_clone(array);
+        visit.how = UArray2b_READ;
+        UArray2b_map_blocks(clone, visit_first_column, sum_cells, &visit);
+        unsigned expected = 7 * BS * BS;
+        for (int i = 0; i < BS; i++) {
+                for (int j = BS; j < H; j++) {
+                        expected += filled(i, j);
+                }
+        }
+        assert(visit.sum == expected);
+        assert(UArray2b_constant(clone, 0, 0) != NULL);
+        UArray2b_free(&array);
+        assert(get_blocked(clone, 0, BS) == filled(0, BS));
+        UArray2b_free(&clone);
+}
+
+/* every kernel level, scalar first */
+static const char *const isas[] = { "scalar", "sse4.2", "avx2", "avx512" };
+#define ISAS ((int) (sizeof(isas) / sizeof(isas[0])))
+
+/* odd widths, widths that are not multiples of 8 or 16 and widths whose
+ * vector loops leave a tail */
+static const int widths[] = { 1, 2, 3, 7, 8, 15, 16, 17, 31, 33, 63, 100 };
+#define WIDTHS ((int) (sizeof(widths) / sizeof(widths[0])))
+#define MOST 100        /* the widest of widths */
+#define OUT 4096        /* bytes of output compared for one kernel call */
+
+/* inputs: arbitrary bytes, pixels with 8 and 16-bit channels, and those
+ * pixels packed by the scalar kernels */
+static unsigned char raster[OUT];
+static struct Pnm_rgb rgb8[MOST + 1];
+static struct Pnm_rgb rgb16[MOST + 1];
+static unsigned char packed4[4 * (MOST + 1)];
+static unsigned char packed8[8 * (MOST + 1)];
+
+/* one kernel call on n elements of the inputs; each reads and writes
+ * one element or sample past the start of its buffers, so no vector
+ * access is aligned */
+typedef void kernelCase(int n, int a, int b, unsigned char *out);
+
+static void reverse_case(int n, int size, int unused, unsigned char *out)
+{
+        (void) unused;
+        A2Kernel_reverse(raster + 1, out + 1, n, size);
+}
+
+static void transpose_case(int n, int orientation, int unused,
+                           unsigned char *out)
+{
+        (void) unused;
+        A2Kernel_transpose32(raster + 4, n + 3, out + 4, n + 5, n,
+                             orientation);
+}
+
+static void pack_case(int n, int size, int unused, unsigned char *out)
+{
+        (void) unused;
+        A2Kernel_pack(size == 4 ? rgb8 + 1 : rgb16 + 1, out + size, n, size);
+}
+
+static void unpack_case(int n, int size, int unused, unsigned char *out)
+{
+        (void) unused;
+        A2Kernel_unpack(size == 4 ? packed4 + 4 : packed8 + 8, out + 4, n,
+                        size);
+}
+
+static void split_case(int n, int depth, int unused, unsigned char *out)
+{
+        (void) unused;
+        void *const planes[3] = {
+                out + depth, out + OUT / 4 + depth, out + OUT / 2 + depth
+        };
+        A2Kernel_split(depth == 1 ? rgb8 + 1 : rgb16 + 1, planes, n, depth);
+}
+
+static void merge_case(int n, int depth, int unused, unsigned char *out)
+{
+        (void) unused;
+        const void *const planes[3] = {
+                raster + depth, raster + OUT / 4 + depth,
+                raster + OUT / 2 + depth
+        };
+        A2Kernel_merge(planes, out + 4, n, depth);
+}
+
+static void parse_case(int n, int depth, int size, unsigned char *out)
+{
+        A2Kernel_parse(raster + 3 * depth, out + size, n, depth, size);
+}
+
+static void format_case(int n, int depth, int size, unsigned char *out)
+{
+        const void *in = raster + size;
+        if (size == 12) {
+                in = depth == 1 ? rgb8 + 1 : rgb16 + 1;
+        } else if (size == 4 * depth) {
+                in = depth == 1 ? packed4 + 4 : packed8 + 8;
+        }
+        A2Kernel_format(in, out + 3 * depth, n, depth, size);
+}
+
+/* runs a kernel case at every level the processor supports and checks
+ * that each writes exactly what the scalar level writes */
+static void same_at_every_level(kernelCase *run, int n, int a, int b)
+{
+        static unsigned char expected[OUT];
+        static unsigned char got[OUT];
+
+        assert(A2Kernel_select("scalar"));
+        memset(expected, 0xee, OUT);
+        run(n, a, b, expected);
+        for (int level = 1; level < ISAS; level++) {
+                if (A2Kernel_select(isas[level])) {
+                        memset(got, 0xee, OUT);
+                        run(n, a, b, got);
+                        assert(memcmp(expected, got, OUT) == 0);
+                }
+        }
+}
+
+static void test_kernels(void)
+{
+        for (int k = 0; k < OUT; k++) {
+                raster[k] = k * 37 + k / 256 + 11;
+        }
+        for (int p = 0; p <= MOST; p++) {
+                rgb8[p] = (struct Pnm_rgb) {
+                        p * 7 % 256, p * 13 % 256, 255 - p
+                };
+                rgb16[p] = (struct Pnm_rgb) {
+                        p * 1031 % 65536, p * 40503 % 65536, 65535 - p
+                };
+        }
+        assert(A2Kernel_select("scalar"));
+        A2Kernel_pack(rgb8, packed4, MOST + 1, 4);
+        A2Kernel_pack(rgb16, packed8, MOST + 1, 8);
+
+        static const int sizes[] = { 1, 2, 3, 4, 6, 8, 12 };
+        for (int w = 0; w < WIDTHS; w++) {
+                int n = widths[w];
+                for (int s = 0; s < (int) (sizeof(sizes) / sizeof(int));
+                     s++) {
+                        same_at_every_level(reverse_case, n, sizes[s], 0);
+                }
+                for (int depth = 1; depth <= 2; depth++) {
+                        same_at_every_level(pack_case, n, 4 * depth, 0);
+                        same_at_every_level(unpack_case, n, 4 * depth, 0);
+                        same_at_every_level(split_case, n, depth, 0);
+                        same_at_every_level(merge_case, n, depth, 0);
+                        int forms[] = { 3 * depth, 4 * depth, 12 };
+                        for (int f = 0; f < 3; f++) {
+                                same_at_every_level(parse_case, n, depth,
+                                                    forms[f]);
+                                same_at_every_level(format_case, n, depth,
+                                                    forms[f]);
+                        }
+                }
+        }
+        for (int n = 8; n <= 24; n += 8) {
+                same_at_every_level(transpose_case, n, A2_ROTATE_90, 0);
+                same_at_every_level(transpose_case, n, A2_ROTATE_270, 0);
+                same_at_every_level(transpose_case, n, A2_TRANSPOSE, 0);
+        }
+
+        /* leave the best supported level bound */
+        for (int level = 0; level < ISAS; level++) {
+                A2Kernel_select(isas[level]);
+        }
+}
+
+#define TW 37   /* transform sources: odd, and not a multiple of any */
+#define TH 23   /* tile or block shape */
+
+/* byte k of the cell at column i, row j of a transform source; the first
+ * 8 rows all hold one value, so blocked sources have constant blocks */
+static inline unsigned char source_byte(int i, int j, int k)
+{
+        if (j < 8) {
+                return 0x5a + k;
+        }
+        return i * 7 + j * 13 + k * 101;
+}
+
+/* where the cell at column i, row j of a width x height array lands */
+static void landing(int orientation, int width, int height, int i, int j,
+                    int *col, int *row)
+{
+        switch (orientation) {
+        case A2_ROTATE_90:       *col = height - 1 - j; *row = i;     break;
+        case A2_ROTATE_180:      *col = width - 1 - i;
+                                 *row = height - 1 - j;              break;
+        case A2_ROTATE_270:      *col = j;     *row = width - 1 - i; break;
+        case A2_FLIP_HORIZONTAL: *col = width - 1 - i; *row = j;     break;
+        case A2_FLIP_VERTICAL:   *col = i;     *row = height - 1 - j; break;
+        case A2_TRANSPOSE:       *col = j;     *row = i;             break;
+        default:                 *col = i;     *row = j;             break;
+        }
+}
+
+static const int orientations[] = {
+        A2_ROTATE_0, A2_ROTATE_90, A2_ROTATE_180, A2_ROTATE_270,
+        A2_FLIP_HORIZONTAL, A2_FLIP_VERTICAL, A2_TRANSPOSE
+};
+#define ORIENTATIONS ((int) (sizeof(orientations) / sizeof(int)))
+
+/* a suite and the block and tile shape its arrays are made with */
+struct suite {
+        A2Methods_T methods;
+        int bw, bh;     /* 0 for the suite's own blocks */
+        int tw, th;     /* 0 for no tiles */
+};
+
+static A2 make(const struct suite *suite, int width, int height, int size)
+{
+        if (suite->bw == 0) {
+                return suite->methods->new_with_blocksize(width, height,
+                                                          size, 8);
+        }
+        A2_set_block_shape(suite->bw, suite->bh);
+        if (suite->tw > 0) {
+                A2_set_tile_shape(suite->tw, suite->th);
+        }
+        return suite->methods->new(width, height, size);
+}
+
+static A2 transform_source(const struct suite *suite, int size)
+{
+        A2Methods_T methods = suite->methods;
+        A2 src = make(suite, TW, TH, size);
+        for (int i = 0; i < TW; i++) {
+                for (int j = 0; j < TH; j++) {
+                        unsigned char *cell = methods->at(src, i, j);
+                        for (int k = 0; k < size; k++) {
+                                cell[k] = source_byte(i, j, k);
+                        }
+                }
+        }
+        if (A2_is_blocked(methods)) {
+                UArray2b_dedup(src);
+        }
+        return src;
+}
+
+/* true if every source cell is at its landing place in dst, or in out
+ * (the destination row by row) if dst is NULL */
+static bool holds_transform(A2Methods_T methods, A2 dst,
+                            const unsigned char *out, int orientation,
+                            int size)
+{
+        int width = A2_transform_width(orientation, TW, TH);
+        for (int i = 0; i < TW; i++) {
+                for (int j = 0; j < TH; j++) {
+                        int col, row;
+                        landing(orientation, TW, TH, i, j, &col, &row);
+                        const unsigned char *cell = dst == NULL
+                                ? out + ((size_t) row * width + col) * size
+                                : methods->at(dst, col, row);
+                        for (int k = 0; k < size; k++) {
+                                if (cell[k] != source_byte(i, j, k)) {
+                                        return false;
+                                }
+                        }
+                }
+        }
+        return true;
+}
+
+/* the transform engines; a map of NULL is the default map */
+enum engine { SCATTER, GATHER, STREAMED, TILED, PREFETCHED, FROM_BAND };
+
+static void run_engine(enum engine engine, A2Methods_T methods,
+                       A2Methods_mapfun *map, A2 src, A2 dst,
+                       int orientation, int size)
+{
+        switch (engine) {
+        case SCATTER:
+                A2_transform(methods, map, src, dst, orientation);
+                break;
+        case GATHER:
+                A2_transform_gather(methods, map, src, dst, orientation);
+                break;
+        case STREAMED:
+                A2_set_stream_threshold(0);
+                A2_transform_gather(methods, map, src, dst, orientation);
+                A2_set_stream_threshold((size_t) 64 << 20);
+                break;
+        case TILED:
+        case PREFETCHED:
+                A2_transform_tiled(methods, src, dst, orientation,
+                                   engine == TILED ? 0 : 2);
+                break;
+        case FROM_BAND: {
+                unsigned char *in = malloc((size_t) TW * TH * size);
+                assert(in != NULL);
+                for (int j = 0; j < TH; j++) {
+                        for (int i = 0; i < TW; i++) {
+                                memcpy(in + ((size_t) j * TW + i) * size,
+                                       methods->at(src, i, j), size);
+                        }
+                }
+                for (int r0 = 0; r0 < TH; r0 += 5) {
+                        int rows = TH - r0 < 5 ? TH - r0 : 5;
+                        A2_transform_from_band(methods,
+                                               in + (size_t) r0 * TW * size,
+                                               TW, TH, r0, rows, dst,
+                                               orientation);
+                }
+                free(in);
+                break;
+        }
+        }
+}
+
+/* transforms src into a new destination with one engine and checks it */
+static void check_engine(const struct suite *suite, enum engine engine,
+                         A2Methods_mapfun *map, A2 src, int orientation,
+                         int size)
+{
+        A2Methods_T methods = suite->methods;
+        A2 dst = make(suite, A2_transform_width(orientation, TW, TH),
+                      A2_transform_height(orientation, TW, TH), size);
+        run_engine(engine, methods, map, src, dst, orientation, size);
+        assert(holds_transform(methods, dst, NULL, orientation, size));
+        methods->free(&dst);
+}
+
+/* produces the destination of src in bands of 5 rows and checks it */
+static void check_bands(A2Methods_T methods, A2 src, int orientation,
+                        int size)
+{
+        int width = A2_transform_width(orientation, TW, TH);
+        int height = A2_transform_height(orientation, TW, TH);
+        unsigned char *out = malloc((size_t) width * height * size);
+        assert(out != NULL);
+        for (int r0 = 0; r0 < height; r0 += 5) {
+                int rows = height - r0 < 5 ? height - r0 : 5;
+                A2_transform_band(methods, src, orientation, r0, rows,
+                                  out + (size_t) r0 * width * size);
+        }
+        assert(holds_transform(methods, NULL, out, orientation, size));
+        free(out);
+}
+
+/* one orientation of src through every engine and, for the ones that
+ * take a map, every map of the suite */
+static void check_orientation(const struct suite *suite, A2 src,
+                              int orientation, int size)
+{
+        A2Methods_T methods = suite->methods;
+        A2Methods_mapfun *maps[] = {
+                methods->map_row_major, methods->map_col_major,
+                methods->map_block_major
+        };
+        for (int e = SCATTER; e <= FROM_BAND; e++) {
+                check_engine(suite, e, NULL, src, orientation, size);
+                for (int m = 0; e <= STREAMED && m < 3; m++) {
+                        if (maps[m] != NULL) {
+                                check_engine(suite, e, maps[m], src,
+                                             orientation, size);
+                        }
+                }
+        }
+        check_bands(methods, src, orientation, size);
+}
+
+static void test_transforms(void)
+{
+        const struct suite suites[] = {
+                { uarray2_methods_plain, 0, 0, 0, 0 },
+                { uarray2_methods_blocked, 0, 0, 0, 0 },
+                { uarray2_methods_blocked_rect, 8, 4, 0, 0 },
+                { uarray2_methods_blocked_rect, 8, 4, 4, 2 },
+                { uarray2_methods_compressed, 0, 0, 0, 0 },
+        };
+        static const int sizes[] = { 1, 3, 4, 8, 12 };
+
+        for (int s = 0; s < (int) (sizeof(suites) / sizeof(suites[0]));
+             s++) {
+                for (int z = 0; z < (int) (sizeof(sizes) / sizeof(int));
+                     z++) {
+                        A2 src = transform_source(&suites[s], sizes[z]);
+                        for (int o = 0; o < ORIENTATIONS; o++) {
+                                check_orientation(&suites[s], src,
+                                                  orientations[o], sizes[z]);
+                        }
+                        suites[s].methods->free(&src);
+                }
+        }
+}
+
+/* the value test_compressed stores at column i, row j in a round, 0 in
+ * round 0; the left half compresses to almost nothing */
+static inline unsigned compressed_fill(int i, int j, unsigned round)
+{
+        return i < 20 || round == 0 ? round
+                                    : filled(i, j) * 2654435761u + round;
+}
+
+static void check_compressed(int i, int j, UArray2bz_T array, void *elem,
+                             void *cl)
+{
+        (void) array;
+        assert(*(unsigned *) elem == compressed_fill(i, j, *(unsigned *) cl));
+}
+
+static void store_compressed(int i, int j, UArray2bz_T array, void *elem,
+                             void *cl)
+{
+        (void) array;
+        *(unsigned *) elem = compressed_fill(i, j, *(unsigned *) cl);
+}
+
+/* every cell of array holds compressed_fill(round), read through at in
+ * column-major order, which leaves the cache on every cell */
+static void holds_compressed(UArray2bz_T array, unsigned round)
+{
+        for (int i = 0; i < UArray2bz_width(array); i++) {
+                for (int j = 0; j < UArray2bz_height(array); j++) {
+                        assert(*(unsigned *) UArray2bz_at(array, i, j) ==
+                               compressed_fill(i, j, round));
+                }
+        }
+}
+
+static void test_compressed(void)
+{
+        /* 10 x 8 blocks, 2 of them cached */
+        UArray2bz_T array = UArray2bz_new(2 * W, 2 * H, sizeof(unsigned), BS,
+                                          2);
+        holds_compressed(array, 0);
+
+        unsigned round = 1;
+        for (int j = 0; j < 2 * H; j++) {
+                for (int i = 0; i < 2 * W; i++) {
+                        unsigned *p = UArray2bz_at(array, i, j);
+                        *p = compressed_fill(i, j, round);
+                }
+        }
+        holds_compressed(array, round);
+        UArray2bz_map(array, check_compressed, &round);
+
+        /* blocks only read and blocks written back both survive eviction */
+        round = 2;
+        UArray2bz_map(array, store_compressed, &round);
+        holds_compressed(array, round);
+        UArray2bz_map(array, check_compressed, &round);
+        UArray2bz_free(&array);
+}
+
+/* a plain image of Pnm_rgb pixels with channels up to denominator */
+static Pnm_ppm rgb_image(unsigned denominator)
+{
+        Pnm_ppm image = malloc(sizeof(*image));
+        assert(image != NULL);
+        image->width = TW;
+        image->height = TH;
+        image->denominator = denominator;
+        image->methods = uarray2_methods_plain;
+        image->pixels = uarray2_methods_plain->new(TW, TH,
+                                                   sizeof(struct Pnm_rgb));
+        for (int i = 0; i < TW; i++) {
+                for (int j = 0; j < TH; j++) {
+                        struct Pnm_rgb *pixel =
+                                uarray2_methods_plain->at(image->pixels, i, j);
+                        pixel->red = (i * 977 + j) % (denominator + 1);
+                        pixel->green = (j * 613 + i) % (denominator + 1);
+                        pixel->blue = (i * j) % (denominator + 1);
+                }
+        }
+        return image;
+}
+
+/* true if the P6 image in fp is image transformed by orientation */
+static bool holds_image(FILE *fp, Pnm_ppm image, int orientation)
+{
+        Ppmio_T input = Ppmio_open(fp);
+        assert(input != NULL);
+        Pnm_ppm read = Ppmio_read(input, uarray2_methods_plain,
+                                  sizeof(struct Pnm_rgb));
+        bool same = read->denominator == image->denominator &&
+                    read->width == (unsigned) A2_transform_width(orientation,
+                                                                 TW, TH) &&
+                    read->height == (unsigned) A2_transform_height(
+                                                        orientation, TW, TH);
+        for (int i = 0; same && i < TW; i++) {
+                for (int j = 0; same && j < TH; j++) {
+                        int col, row;
+                        landing(orientation, TW, TH, i, j, &col, &row);
+                        same = memcmp(uarray2_methods_plain->at(image->pixels,
+                                                                i, j),
+                                      read->methods->at(read->pixels, col,
+                                                        row),
+                                      sizeof(struct Pnm_rgb)) == 0;
+                }
+        }
+        Pnm_ppmfree(&read);
+        Ppmio_close(&input);
+        return same;
+}
+
+static FILE *written(Pnm_ppm image, int orientation)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        Ppmio_write_transformed(fp, image, orientation);
+        return fp;
+}
+
+static void test_ppmio(void)
+{
+        const A2Methods_T suites[] = {
+                uarray2_methods_plain, uarray2_methods_blocked,
+                uarray2_methods_compressed
+        };
+        for (unsigned denominator = 255; denominator <= 1000;
+             denominator += 745) {
+                Pnm_ppm image = rgb_image(denominator);
+                FILE *fp = tmpfile();
+                assert(fp != NULL);
+                Ppmio_write(fp, image);
+                assert(holds_image(fp, image, A2_ROTATE_0));
+                Ppmio_T input = Ppmio_open(fp);
+                assert(input != NULL);
+                assert(Ppmio_width(input) == TW &&
+                       Ppmio_height(input) == TH &&
+                       Ppmio_denominator(input) == denominator);
+
+                /* every pixel size in every backend reads and writes back
+                 * the same image */
+                int depth = denominator <= 255 ? 1 : 2;
+                int sizes[] = { 3 * depth, 4 * depth, 12 };
+                for (int m = 0; m < 3; m++) {
+                        for (int z = 0; z < 3; z++) {
+                                Pnm_ppm read = Ppmio_read(input, suites[m],
+                                                          sizes[z]);
+                                FILE *out = written(read, A2_ROTATE_0);
+                                assert(holds_image(out, image,
+                                                   A2_ROTATE_0));
+                                fclose(out);
+                                Pnm_ppmfree(&read);
+                        }
+                }
+
+                for (int o = 0; o < ORIENTATIONS; o++) {
+                        int orientation = orientations[o];
+                        FILE *out = written(image, orientation);
+                        assert(holds_image(out, image, orientation));
+                        fclose(out);
+
+                        Pnm_ppm read = Ppmio_read_transformed(input,
+                                                uarray2_methods_plain, 12,
+                                                orientation);
+                        out = written(read, A2_ROTATE_0);
+                        assert(holds_image(out, image, orientation));
+                        fclose(out);
+                        Pnm_ppmfree(&read);
+
+                        out = tmpfile();
+                        assert(out != NULL);
+                        if (A2_transform_width(orientation, 1, 2) == 1) {
+                                Ppmio_stream(out, input, orientation);
+                        } else {
+                                /* a budget of one byte spills every band */
+                                Ppmio_transform_out_of_core(out, input,
+                                                            orientation, 1);
+                        }
+                        assert(holds_image(out, image, orientation));
+                        fclose(out);
+                }
+                Ppmio_close(&input);
+                fclose(fp);
+                uarray2_methods_plain->free(&image->pixels);
+                free(image);
+        }
+}
+
+static void test_allocators(void)
+{
+        /* a freed buffer is handed out again for any size of its class */
+        A2Alloc_T pool = A2Alloc_pool_new();
+        char *p = pool->alloc(pool, 100);
+        assert((uintptr_t) p % 64 == 0);
+        pool->free(pool, p, 100);
+        assert(pool->alloc(pool, 128) == p);
+        char *q = pool->alloc(pool, 100);
+        assert(q != p);
+        pool->free(pool, q, 100);
+        pool->free(pool, p, 128);
+
+        /* an arena cuts aligned pieces from a chunk of its parent and
+         * gives the chunk back on reset, here for the pool to hand out
+         * again */
+        A2Alloc_T arena = A2Alloc_arena_new(pool, 4096);
+        char *a = arena->alloc(arena, 100);
+        char *b = arena->alloc(arena, 100);
+        assert((uintptr_t) a % 64 == 0 && (uintptr_t) b % 64 == 0);
+        assert(b >= a + 100 || a >= b + 100);
+        A2Alloc_arena_reset(arena);
+        assert(arena->alloc(arena, 100) == a);
+        A2Alloc_arena_reset(arena);
+
+        /* arrays made under an arena work and are gone with the reset */
+        A2Alloc_use(arena);
+        assert(A2Alloc_current() == arena);
+        for (int k = 0; k < 2; k++) {
+                UArray2b_T array = UArray2b_new(W, H, sizeof(unsigned), BS);
+                fill_blocked(array);
+                assert(holds_fill(array, -1, -1));
+                UArray2b_free(&array);
+                A2Alloc_arena_reset(arena);
+        }
+        A2Alloc_use(A2Alloc_malloc);
+        A2Alloc_arena_free(&arena);
+        A2Alloc_pool_free(&pool);
+}
+
 int main(int argc, char *argv[])
 {
         assert(argc == 1);
         (void)argv;
         
-        
+        test_save_load();
+        test_constant_blocks();
+        test_clones();
+        test_map_blocks();
+        test_kernels();
+        test_transforms();
+        test_compressed();
+        test_ppmio();
+        test_allocators();
         test_methods(uarray2_methods_plain);
         test_methods(uarray2_methods_blocked);
         printf("Passed.\n");  /* only if we reach this point without
@@ -0,0 +1,1504 @@
+/**************************************************************
+ *
+ *                     a2transform.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of geometric transforms between A2 arrays.
+ *              Either the source is traversed with a client chosen map and
+ *              every element is scattered to its transformed position, or the
+ *              destination is traversed and every element is gathered from
+ *              its original position. One apply function exists per
+ *              supported element size so that each copy is a fixed size move
+ *              the compiler can inline; other sizes fall back to memcpy.
+ *              Bands of destination rows can also be produced on their own,
+ *              for consumers that never need the whole destination, and
+ *              bands of source rows consumed, for producers that never make
+ *              the whole source. A destination block of a blocked array
+ *              whose source is all one constant value is filled with it
+ *              without copying.
+ *              Scratch buffers come from the calling thread's allocator.
+ *
+ **************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "assert.h"
+#include "a2transform.h"
+#include "a2kernels.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2rect.h"
+#include "a2alloc.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+
+#define TILE 16         /* elements along each side of a scratch tile */
+#define LINE 64         /* bytes in a cache line */
+#define CHUNK 4096      /* bytes gathered per row chunk before streaming */
+
+/* destinations of at least this many bytes are written with non-temporal
+ * stores; see A2_set_stream_threshold */
+static size_t streamThreshold = (size_t) 64 << 20;
+
+typedef A2Methods_UArray2 A2;
+
+/*
+ * Struct to pass the array that is not being traversed and the information
+ * needed to find each element's other position into the apply functions.
+ */
+struct transformCl {
+        A2Methods_T methods;    /* methods shared by source and destination */
+        A2 other;               /* destination when scattering, source when
+                                 * gathering */
+        int orientation;        /* one of the A2_* orientation codes */
+        int width;              /* width of the source array */
+        int height;             /* height of the source array */
+        int size;               /* bytes per element, used by the memcpy
+                                 * fallback kernels */
+};
+
+/********** swapsDimensions ********
+ *
+ * Tells whether an orientation exchanges the width and height of an array
+ *
+ * Parameters:
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: true for 90 and 270 degree rotations and transposition
+ *
+ ************************/
+static inline bool swapsDimensions(int orientation)
+{
+        return orientation == A2_ROTATE_90 || orientation == A2_ROTATE_270 ||
+               orientation == A2_TRANSPOSE;
+}
+
+/********** A2_transform_width ********
+ *
+ * Gets the width an array will have after being transformed
+ *
+ * Parameters:
+ *      int orientation:        one of the A2_* orientation codes
+ *      int width:              the width of the source array
+ *      int height:             the height of the source array
+ *
+ * Return: the width of the transformed array
+ *
+ ************************/
+int A2_transform_width(int orientation, int width, int height)
+{
+        return swapsDimensions(orientation) ? height : width;
+}
+
+/********** A2_transform_height ********
+ *
+ * Gets the height an array will have after being transformed
+ *
+ * Parameters:
+ *      int orientation:        one of the A2_* orientation codes
+ *      int width:              the width of the source array
+ *      int height:             the height of the source array
+ *
+ * Return: the height of the transformed array
+ *
+ ************************/
+int A2_transform_height(int orientation, int width, int height)
+{
+        return swapsDimensions(orientation) ? width : height;
+}
+
+/********** destination ********
+ *
+ * Computes where the source element at (i, j) lands in the destination
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform being performed
+ *      int i, j:                       column and row in the source
+ *      int *col, *row:                 set to the column and row in the
+ *                                      destination
+ *
+ * Return: n/a
+ *
+ ************************/
+static inline void destination(struct transformCl *bundle, int i, int j,
+                               int *col, int *row)
+{
+        int width = bundle->width;
+        int height = bundle->height;
+
+        switch (bundle->orientation) {
+        case A2_ROTATE_90:
+                *col = height - j - 1;
+                *row = i;
+                break;
+        case A2_ROTATE_180:
+                *col = width - i - 1;
+                *row = height - j - 1;
+                break;
+        case A2_ROTATE_270:
+                *col = j;
+                *row = width - i - 1;
+                break;
+        case A2_TRANSPOSE:
+                *col = j;
+                *row = i;
+                break;
+        case A2_FLIP_HORIZONTAL:
+                *col = width - i - 1;
+                *row = j;
+                break;
+        case A2_FLIP_VERTICAL:
+                *col = i;
+                *row = height - j - 1;
+                break;
+        default:
+                *col = i;
+                *row = j;
+                break;
+        }
+}
+
+/********** source ********
+ *
+ * Computes which source element lands at (i, j) in the destination; the
+ * inverse of destination
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform being performed
+ *      int i, j:                       column and row in the destination
+ *      int *col, *row:                 set to the column and row in the
+ *                                      source
+ *
+ * Return: n/a
+ *
+ ************************/
+static inline void source(struct transformCl *bundle, int i, int j,
+                          int *col, int *row)
+{
+        int width = bundle->width;
+        int height = bundle->height;
+
+        switch (bundle->orientation) {
+        case A2_ROTATE_90:
+                *col = j;
+                *row = height - i - 1;
+                break;
+        case A2_ROTATE_180:
+                *col = width - i - 1;
+                *row = height - j - 1;
+                break;
+        case A2_ROTATE_270:
+                *col = width - j - 1;
+                *row = i;
+                break;
+        case A2_TRANSPOSE:
+                *col = j;
+                *row = i;
+                break;
+        case A2_FLIP_HORIZONTAL:
+                *col = width - i - 1;
+                *row = j;
+                break;
+        case A2_FLIP_VERTICAL:
+                *col = i;
+                *row = height - j - 1;
+                break;
+        default:
+                *col = i;
+                *row = j;
+                break;
+        }
+}
+
+/*
+ * Defines a pair of apply functions that copy one element of exactly BYTES
+ * bytes: SCATTER is mapped over the source and writes the element to its
+ * transformed position, GATHER is mapped over the destination and reads the
+ * element from its original position. memcpy with a constant size compiles
+ * to one or two register moves and, unlike a cast, is safe for any element
+ * type.
+ */
+#define COPY_KERNELS(SCATTER, GATHER, BYTES)                            \
+static void SCATTER(int i, int j, A2 src, void *elem, void *cl)        \
+{                                                                       \
+        struct transformCl *bundle = cl;                                \
+        int col, row;                                                   \
+        (void) src;                                                     \
+        destination(bundle, i, j, &col, &row);                          \
+        memcpy(bundle->methods->at(bundle->other, col, row), elem,      \
+                                                                BYTES); \
+}                                                                       \
+static void GATHER(int i, int j, A2 dst, void *elem, void *cl)         \
+{                                                                       \
+        struct transformCl *bundle = cl;                                \
+        int col, row;                                                   \
+        (void) dst;                                                     \
+        source(bundle, i, j, &col, &row);                               \
+        memcpy(elem, bundle->methods->at(bundle->other, col, row),      \
+                                                                BYTES); \
+}
+
+COPY_KERNELS(scatter1,  gather1,   1)
+COPY_KERNELS(scatter2,  gather2,   2)
+COPY_KERNELS(scatter3,  gather3,   3)
+COPY_KERNELS(scatter4,  gather4,   4)
+COPY_KERNELS(scatter8,  gather8,   8)
+COPY_KERNELS(scatter12, gather12, 12)
+COPY_KERNELS(scatter16, gather16, 16)
+COPY_KERNELS(scatterAny, gatherAny, bundle->size)
+
+#undef COPY_KERNELS
+
+/*
+ * Defines a function that transforms a tw x th tile of BYTES byte elements
+ * held in the scratch buffer in into the scratch buffer out. Rows of both
+ * buffers are TILE elements apart, and both buffers are small enough to stay
+ * in L1 while the tile is rearranged.
+ */
+#define TILE_KERNEL(NAME, BYTES)                                        \
+static void NAME(const char *in, char *out, int tw, int th,             \
+                 int orientation, int size)                             \
+{                                                                       \
+        struct transformCl bundle = {                                   \
+                NULL, NULL, orientation, tw, th, size                   \
+        };                                                              \
+        int dw = A2_transform_width(orientation, tw, th);               \
+        int dh = A2_transform_height(orientation, tw, th);              \
+        (void) size;                                                    \
+        for (int r = 0; r < dh; r++) {                                  \
+                for (int c = 0; c < dw; c++) {                          \
+                        int col, row;                                   \
+                        source(&bundle, c, r, &col, &row);              \
+                        memcpy(out + (r * TILE + c) * (BYTES),          \
+                               in + (row * TILE + col) * (BYTES),       \
+                               BYTES);                                  \
+                }                                                       \
+        }                                                               \
+}
+
+TILE_KERNEL(tile1,    1)
+TILE_KERNEL(tile2,    2)
+TILE_KERNEL(tile3,    3)
+TILE_KERNEL(tile4,    4)
+TILE_KERNEL(tile8,    8)
+TILE_KERNEL(tile12,  12)
+TILE_KERNEL(tile16,  16)
+TILE_KERNEL(tileAny, size)
+
+#undef TILE_KERNEL
+
+/********** tile4Simd ********
+ *
+ * Transforms a tile of 4 byte elements, handing full tiles that are
+ * transposed or rotated by 90 or 270 degrees to the SIMD transpose kernel
+ *
+ * Parameters: the same as the TILE_KERNEL functions
+ *
+ * Return: n/a
+ *
+ ************************/
+static void tile4Simd(const char *in, char *out, int tw, int th,
+                      int orientation, int size)
+{
+        if (tw == TILE && th == TILE && swapsDimensions(orientation)) {
+                A2Kernel_transpose32(in, TILE, out, TILE, TILE, orientation);
+        } else {
+                tile4(in, out, tw, th, orientation, size);
+        }
+}
+
+/*
+ * Defines a function that gathers n BYTES byte elements of destination row r,
+ * starting at column c0, from the plain source array in bundle->other into
+ * the staging buffer out.
+ */
+#define ROW_KERNEL(NAME, BYTES)                                         \
+static void NAME(struct transformCl *bundle, char *out, int c0, int r,  \
+                 int n)                                                 \
+{                                                                       \
+        UArray2_T src = bundle->other;                                  \
+        int size = bundle->size;                                        \
+        (void) size;                                                    \
+        for (int k = 0; k < n; k++) {                                   \
+                int col, row;                                           \
+                source(bundle, c0 + k, r, &col, &row);                  \
+                memcpy(out + k * (BYTES),                               \
+                       (char *) UArray2_row(src, row) + col * (BYTES),  \
+                       BYTES);                                          \
+        }                                                               \
+}
+
+ROW_KERNEL(row1,    1)
+ROW_KERNEL(row2,    2)
+ROW_KERNEL(row3,    3)
+ROW_KERNEL(row4,    4)
+ROW_KERNEL(row8,    8)
+ROW_KERNEL(row12,  12)
+ROW_KERNEL(row16,  16)
+ROW_KERNEL(rowAny, size)
+
+#undef ROW_KERNEL
+
+typedef void tilefun(const char *in, char *out, int tw, int th,
+                     int orientation, int size);
+typedef void rowfun(struct transformCl *bundle, char *out, int c0, int r,
+                    int n);
+
+/*
+ * The specialized kernels, looked up by element size. Sizes not in the
+ * table use the Any kernels.
+ */
+static const struct copyKernel {
+        int size;
+        A2Methods_applyfun *scatter;
+        A2Methods_applyfun *gather;
+        tilefun *tile;
+        rowfun *row;
+} kernels[] = {
+        {  1, scatter1,  gather1,  tile1,     row1  },
+        {  2, scatter2,  gather2,  tile2,     row2  },
+        {  3, scatter3,  gather3,  tile3,     row3  },
+        {  4, scatter4,  gather4,  tile4Simd, row4  },
+        {  8, scatter8,  gather8,  tile8,     row8  },
+        { 12, scatter12, gather12, tile12,    row12 },
+        { 16, scatter16, gather16, tile16,    row16 },
+};
+
+static const struct copyKernel fallback = {
+        0, scatterAny, gatherAny, tileAny, rowAny
+};
+
+/********** findKernel ********
+ *
+ * Chooses the copy kernels specialized for an element size
+ *
+ * Parameters:
+ *      int size:       the number of bytes in an element
+ *
+ * Return: the matching kernels, or the memcpy fallback if there are none
+ *
+ ************************/
+static const struct copyKernel *findKernel(int size)
+{
+        int n = sizeof(kernels) / sizeof(kernels[0]);
+        for (int i = 0; i < n; i++) {
+                if (kernels[i].size == size) {
+                        return &kernels[i];
+                }
+        }
+        return &fallback;
+}
+
+/********** streamCopy ********
+ *
+ * Copies n bytes to dst with non-temporal stores, which write around the
+ * cache instead of first reading each destination line for ownership
+ *
+ * Parameters:
+ *      char *dst:              where the bytes are written
+ *      const char *src:        where the bytes are read
+ *      size_t n:               the number of bytes to copy
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - The bytes before the first 16 byte boundary of dst and after the
+ *      last one are copied with ordinary stores
+ *      - Callers must call streamFence once all streaming copies are done
+ *      - Without SSE2 this is memcpy
+ *
+ ************************/
+static void streamCopy(char *dst, const char *src, size_t n)
+{
+#ifdef __SSE2__
+        size_t head = (16 - ((uintptr_t) dst & 15)) & 15;
+        if (head > n) {
+                head = n;
+        }
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        n -= head;
+        for (; n >= 16; n -= 16, dst += 16, src += 16) {
+                _mm_stream_si128((__m128i *) dst,
+                                 _mm_loadu_si128((const __m128i *) src));
+        }
+#endif
+        memcpy(dst, src, n);
+}
+
+/********** streamFence ********
+ *
+ * Orders all earlier non-temporal stores before any later store
+ *
+ ************************/
+static void streamFence(void)
+{
+#ifdef __SSE2__
+        _mm_sfence();
+#endif
+}
+
+/********** streams ********
+ *
+ * Tells whether a plain destination is large enough to be written with
+ * non-temporal stores
+ *
+ * Parameters:
+ *      UArray2_T dst:  the destination array
+ *
+ * Return: true if dst holds at least streamThreshold bytes
+ *
+ ************************/
+static bool streams(UArray2_T dst)
+{
+        size_t bytes = (size_t) UArray2_width(dst) * UArray2_height(dst) *
+                                                            UArray2_size(dst);
+        return bytes >= streamThreshold;
+}
+
+/********** A2_set_stream_threshold ********
+ *
+ * Sets the destination size above which transforms that write the
+ * destination sequentially use non-temporal stores
+ *
+ * Parameters:
+ *      size_t bytes:   the threshold in bytes; 0 streams every destination,
+ *                      SIZE_MAX none
+ *
+ * Return: n/a
+ *
+ ************************/
+void A2_set_stream_threshold(size_t bytes)
+{
+        streamThreshold = bytes;
+}
+
+/********** checkShapes ********
+ *
+ * Asserts that src and dst are compatible for a transform
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both src and dst
+ *      A2 src, dst:            the source and destination arrays
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if the sizes or dimensions of src and dst do not match
+ *
+ ************************/
+static void checkShapes(A2Methods_T methods, A2 src, A2 dst, int orientation)
+{
+        int width = methods->width(src);
+        int height = methods->height(src);
+
+        assert(methods->size(dst) == methods->size(src));
+        assert(methods->width(dst) ==
+                               A2_transform_width(orientation, width, height));
+        assert(methods->height(dst) ==
+                              A2_transform_height(orientation, width, height));
+}
+
+/********** constantSource ********
+ *
+ * Finds whether a rectangle of a blocked array lies in constant blocks
+ * (see UArray2b_constant) that all hold the same value
+ *
+ * Parameters:
+ *      UArray2b_T src:         the array
+ *      int x0, y0:             column and row of one corner
+ *      int x1, y1:             column and row of the opposite corner, in
+ *                              any order with respect to the first
+ *
+ * Return: the value, or NULL if any block is not constant or the blocks
+ *         hold different values
+ *
+ ************************/
+static const void *constantSource(UArray2b_T src, int x0, int y0, int x1,
+                                  int y1)
+{
+        int bw = UArray2b_block_width(src);
+        int bh = UArray2b_block_height(src);
+        int size = UArray2b_size(src);
+        int left = (x0 < x1 ? x0 : x1) / bw;
+        int right = (x0 < x1 ? x1 : x0) / bw;
+        int top = (y0 < y1 ? y0 : y1) / bh;
+        int bottom = (y0 < y1 ? y1 : y0) / bh;
+
+        const void *value = UArray2b_constant(src, left * bw, top * bh);
+        for (int by = top; value != NULL && by <= bottom; by++) {
+                for (int bx = left; bx <= right; bx++) {
+                        const void *other = UArray2b_constant(src, bx * bw,
+                                                              by * bh);
+                        if (other == NULL || memcmp(other, value, size) != 0) {
+                                return NULL;
+                        }
+                }
+        }
+        return value;
+}
+
+/*
+ * Struct to pass a transform between blocked arrays, and which destination
+ * blocks were already filled with a constant, into scatterBlocked and
+ * gatherBlocked.
+ */
+struct blockedCl {
+        struct transformCl *bundle;     /* the transform being performed */
+        UArray2b_T src;                 /* the source array */
+        UArray2b_T dst;                 /* the destination array */
+        bool *filled;   /* per destination block, in row-major order of
+                         * the blocks, or NULL if no block was filled */
+        int blockWidth;         /* the block shape of dst */
+        int blockHeight;
+        int blocksWide;         /* blocks in a row of blocks of dst */
+        bool checked;   /* whether the cells copied must be checked against
+                         * filled, false while the block being visited
+                         * touches no filled block */
+};
+
+/********** fillConstantBlocks ********
+ *
+ * Fills every destination block whose source cells all lie in constant
+ * blocks of one value with that value
+ *
+ * Parameters:
+ *      struct blockedCl *blocked:      the transform, whose filled is set
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - Nothing is copied for a filled block; the transform of a
+ *      constant block is constant
+ *
+ ************************/
+static void fillConstantBlocks(struct blockedCl *blocked)
+{
+        UArray2b_T dst = blocked->dst;
+        int width = UArray2b_width(dst);
+        int height = UArray2b_height(dst);
+        int bw = blocked->blockWidth;
+        int bh = blocked->blockHeight;
+        int blocksHigh = height / bh + (height % bh != 0);
+
+        blocked->filled = NULL;
+        for (int y0 = 0; y0 < height; y0 += bh) {
+                int y1 = (y0 + bh < height ? y0 + bh : height) - 1;
+                for (int x0 = 0; x0 < width; x0 += bw) {
+                        int x1 = (x0 + bw < width ? x0 + bw : width) - 1;
+                        int sx0, sy0, sx1, sy1;
+                        source(blocked->bundle, x0, y0, &sx0, &sy0);
+                        source(blocked->bundle, x1, y1, &sx1, &sy1);
+                        const void *value = constantSource(blocked->src,
+                                                           sx0, sy0,
+                                                           sx1, sy1);
+                        if (value == NULL) {
+                                continue;
+                        }
+
+                        UArray2b_fill_block(dst, x0, y0, value);
+                        if (blocked->filled == NULL) {
+                                blocked->filled = calloc((size_t) blocksHigh *
+                                                         blocked->blocksWide,
+                                                         sizeof(bool));
+                                assert(blocked->filled != NULL);
+                        }
+                        blocked->filled[(size_t) (y0 / bh) *
+                                        blocked->blocksWide + x0 / bw] = true;
+                }
+        }
+}
+
+/********** filledAt ********
+ *
+ * Tells whether the destination block holding a cell was filled by
+ * fillConstantBlocks
+ *
+ * Parameters:
+ *      struct blockedCl *blocked:      the transform
+ *      int col, row:                   the cell in the destination
+ *
+ * Return: true if it was, so the cell must not be written
+ *
+ ************************/
+static inline bool filledAt(struct blockedCl *blocked, int col, int row)
+{
+        return blocked->filled != NULL &&
+               blocked->filled[(size_t) (row / blocked->blockHeight) *
+                               blocked->blocksWide +
+                               col / blocked->blockWidth];
+}
+
+/********** scatterBlocked ********
+ *
+ * Copies one source element of a blocked transform to its transformed
+ * position, unless that position is in a filled block (checked only if
+ * blocked->checked)
+ *
+ * Parameters: the same as any A2Methods_applyfun, cl being a struct
+ *             blockedCl
+ *
+ * Return: n/a
+ *
+ ************************/
+static void scatterBlocked(int i, int j, A2 src, void *elem, void *cl)
+{
+        struct blockedCl *blocked = cl;
+        int col, row;
+        (void) src;
+        destination(blocked->bundle, i, j, &col, &row);
+        if (!blocked->checked || !filledAt(blocked, col, row)) {
+                memcpy(UArray2b_at(blocked->dst, col, row), elem,
+                       blocked->bundle->size);
+        }
+}
+
+/********** gatherBlocked ********
+ *
+ * Copies one destination element of a blocked transform from its original
+ * position, unless it is in a filled block (checked only if
+ * blocked->checked)
+ *
+ * Parameters: the same as any A2Methods_applyfun, cl being a struct
+ *             blockedCl
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - The source is read with UArray2b_get, so constant and shared
+ *      source blocks are left as they are
+ *
+ ************************/
+static void gatherBlocked(int i, int j, A2 dst, void *elem, void *cl)
+{
+        struct blockedCl *blocked = cl;
+        int col, row;
+        (void) dst;
+        if (blocked->checked && filledAt(blocked, i, j)) {
+                return;
+        }
+        source(blocked->bundle, i, j, &col, &row);
+        memcpy(elem, UArray2b_get(blocked->src, col, row),
+               blocked->bundle->size);
+}
+
+/* the apply function of UArray2b_map_blocks, which scatterBlocked and
+ * gatherBlocked are with A2 being a UArray2b_T */
+typedef void mapApply(int i, int j, UArray2b_T array2b, void *elem, void *cl);
+
+/********** scatterVisit ********
+ *
+ * Tells UArray2b_map_blocks how to visit a source block when scattering:
+ * not at all if every cell it lands on is in a filled destination block,
+ * otherwise reading it, checking cells against the filled blocks only if
+ * it lands on some of them
+ *
+ * Parameters:
+ *      int col, row:           the first cell of the source block
+ *      UArray2b_T src:         the source array
+ *      void *cl:               the struct blockedCl of the transform, whose
+ *                              checked is set
+ *
+ * Return: UArray2b_SKIP or UArray2b_READ
+ *
+ ************************/
+static int scatterVisit(int col, int row, UArray2b_T src, void *cl)
+{
+        struct blockedCl *blocked = cl;
+        blocked->checked = false;
+        if (blocked->filled == NULL) {
+                return UArray2b_READ;
+        }
+
+        int x1 = col + UArray2b_block_width(src);
+        int y1 = row + UArray2b_block_height(src);
+        x1 = (x1 < UArray2b_width(src) ? x1 : UArray2b_width(src)) - 1;
+        y1 = (y1 < UArray2b_height(src) ? y1 : UArray2b_height(src)) - 1;
+        int dx0, dy0, dx1, dy1;
+        destination(blocked->bundle, col, row, &dx0, &dy0);
+        destination(blocked->bundle, x1, y1, &dx1, &dy1);
+        int left = (dx0 < dx1 ? dx0 : dx1) / blocked->blockWidth;
+        int right = (dx0 < dx1 ? dx1 : dx0) / blocked->blockWidth;
+        int top = (dy0 < dy1 ? dy0 : dy1) / blocked->blockHeight;
+        int bottom = (dy0 < dy1 ? dy1 : dy0) / blocked->blockHeight;
+
+        int filled = 0;
+        for (int by = top; by <= bottom; by++) {
+                for (int bx = left; bx <= right; bx++) {
+                        filled += blocked->filled[(size_t) by *
+                                                  blocked->blocksWide + bx];
+                }
+        }
+        if (filled == (right - left + 1) * (bottom - top + 1)) {
+                return UArray2b_SKIP;
+        }
+        blocked->checked = filled > 0;
+        return UArray2b_READ;
+}
+
+/********** gatherVisit ********
+ *
+ * Tells UArray2b_map_blocks how to visit a destination block when
+ * gathering: not at all if it was filled, otherwise writing every cell
+ *
+ * Parameters:
+ *      int col, row:           the first cell of the destination block
+ *      UArray2b_T dst:         the destination array
+ *      void *cl:               the struct blockedCl of the transform
+ *
+ * Return: UArray2b_SKIP or UArray2b_WRITE
+ *
+ ************************/
+static int gatherVisit(int col, int row, UArray2b_T dst, void *cl)
+{
+        (void) dst;
+        return filledAt(cl, col, row) ? UArray2b_SKIP : UArray2b_WRITE;
+}
+
+/********** transformBlocks ********
+ *
+ * Transforms between blocked arrays, skipping destination blocks whose
+ * source is one constant value
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform being performed
+ *      A2Methods_mapfun *map:          the map traversing src (scatter) or
+ *                                      dst (gather)
+ *      UArray2b_T src:                 the source array
+ *      UArray2b_T dst:                 the destination array
+ *      bool scatter:                   true to traverse the source
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - Constant destination blocks are filled first
+ *      (fillConstantBlocks); every other cell is copied by map, so the
+ *      traversal and prefetching (UArray2b_set_prefetch) of the array
+ *      mapped apply as for any other transform
+ *      - The block-major map of the blocked suites is run as
+ *      UArray2b_map_blocks, which skips the filled blocks whole, reads the
+ *      source where it is and writes destination blocks in place; any
+ *      other map visits every cell and checks it against the filled blocks
+ *
+ ************************/
+static void transformBlocks(struct transformCl *bundle,
+                            A2Methods_mapfun *map, UArray2b_T src,
+                            UArray2b_T dst, bool scatter)
+{
+        int bw = UArray2b_block_width(dst);
+        int width = UArray2b_width(dst);
+        struct blockedCl blocked = {
+                bundle, src, dst, NULL, bw, UArray2b_block_height(dst),
+                width / bw + (width % bw != 0), true
+        };
+
+        fillConstantBlocks(&blocked);
+        if (map == bundle->methods->map_block_major) {
+                if (scatter) {
+                        UArray2b_map_blocks(src, scatterVisit,
+                                            (mapApply *) scatterBlocked,
+                                            &blocked);
+                } else {
+                        UArray2b_map_blocks(dst, gatherVisit,
+                                            (mapApply *) gatherBlocked,
+                                            &blocked);
+                }
+        } else if (scatter) {
+                map(src, scatterBlocked, &blocked);
+        } else {
+                map(dst, gatherBlocked, &blocked);
+        }
+        free(blocked.filled);
+}
+
+/********** A2_transform ********
+ *
+ * Copies every element of src into dst at its rotated, flipped or transposed
+ * position, traversing the source (scatter)
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both src and dst
+ *      A2Methods_mapfun *map:  the map used to traverse src, or NULL to use
+ *                              the default map of methods
+ *      A2 src:                 the array being transformed
+ *      A2 dst:                 the array receiving the result
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: n/a
+ *
+ * Expects: methods, src and dst to not be NULL; src and dst to have the same
+ *          element size; dst to have the dimensions given by
+ *          A2_transform_width and A2_transform_height
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Elements of 1, 2, 3, 4, 8, 12 and 16 bytes are copied by fixed size
+ *      kernels, every other size by memcpy
+ *      - For blocked arrays, destination blocks whose source is one
+ *      constant value are filled without copying (transformBlocks)
+ *
+ ************************/
+void A2_transform(A2Methods_T methods, A2Methods_mapfun *map, A2 src, A2 dst,
+                  int orientation)
+{
+        assert(methods != NULL);
+        assert(src != NULL && dst != NULL);
+
+        if (map == NULL) {
+                map = methods->map_default;
+        }
+        assert(map != NULL);
+        checkShapes(methods, src, dst, orientation);
+
+        int size = methods->size(src);
+        struct transformCl bundle = {
+                methods, dst, orientation,
+                methods->width(src), methods->height(src), size
+        };
+        if (A2_is_blocked(methods)) {
+                transformBlocks(&bundle, map, src, dst, true);
+                return;
+        }
+        map(src, findKernel(size)->scatter, &bundle);
+}
+
+/********** gatherStreaming ********
+ *
+ * Gathers a plain destination row by row, staging CHUNK bytes at a time in
+ * an aligned buffer that is then streamed to the destination
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform, with the plain source
+ *                                      array in bundle->other
+ *      UArray2_T dst:                  the destination array
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if the staging buffer cannot be allocated
+ *
+ ************************/
+static void gatherStreaming(struct transformCl *bundle, UArray2_T dst)
+{
+        int size = bundle->size;
+        int width = UArray2_width(dst);
+        int height = UArray2_height(dst);
+        int perChunk = size < CHUNK ? CHUNK / size : 1;
+        rowfun *gatherRow = findKernel(size)->row;
+
+        A2Alloc_T alloc = A2Alloc_current();
+        void *staging = alloc->alloc(alloc, (size_t) perChunk * size);
+
+        for (int r = 0; r < height; r++) {
+                char *row = UArray2_row(dst, r);
+                for (int c0 = 0; c0 < width; c0 += perChunk) {
+                        int n = width - c0 < perChunk ? width - c0 : perChunk;
+                        gatherRow(bundle, staging, c0, r, n);
+                        streamCopy(row + c0 * size, staging,
+                                                           (size_t) n * size);
+                }
+        }
+        streamFence();
+
+        alloc->free(alloc, staging, (size_t) perChunk * size);
+}
+
+/********** A2_transform_gather ********
+ *
+ * Fills every element of dst from its original position in src, traversing
+ * the destination (gather). Writes then follow the storage order of the map
+ * and the strided accesses move to the reads.
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both src and dst
+ *      A2Methods_mapfun *map:  the map used to traverse dst, or NULL to use
+ *                              the default map of methods
+ *      A2 src:                 the array being transformed
+ *      A2 dst:                 the array receiving the result
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: n/a
+ *
+ * Expects: the same as A2_transform
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Row-major gathers into plain destinations of at least the stream
+ *      threshold are written with non-temporal stores
+ *      - For blocked arrays, constant blocks are filled as by
+ *      A2_transform
+ *
+ ************************/
+void A2_transform_gather(A2Methods_T methods, A2Methods_mapfun *map, A2 src,
+                         A2 dst, int orientation)
+{
+        assert(methods != NULL);
+        assert(src != NULL && dst != NULL);
+
+        if (map == NULL) {
+                map = methods->map_default;
+        }
+        assert(map != NULL);
+        checkShapes(methods, src, dst, orientation);
+
+        int size = methods->size(src);
+        struct transformCl bundle = {
+                methods, src, orientation,
+                methods->width(src), methods->height(src), size
+        };
+        if (methods == uarray2_methods_plain &&
+            map == methods->map_row_major && streams(dst)) {
+                gatherStreaming(&bundle, dst);
+                return;
+        }
+        if (A2_is_blocked(methods)) {
+                transformBlocks(&bundle, map, src, dst, false);
+                return;
+        }
+        map(dst, findKernel(size)->gather, &bundle);
+}
+
+/********** prefetchRect ********
+ *
+ * Issues software prefetches for every cache line of a rectangle of a plain
+ * array
+ *
+ * Parameters:
+ *      UArray2_T array:        the array holding the rectangle
+ *      int x, y:               column and row of the upper left corner
+ *      int w, h:               width and height of the rectangle
+ *      bool forWrite:          true if the lines are about to be written
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Prefetches are hints, the rectangle may run off the array and is
+ *      then clipped
+ *
+ ************************/
+static void prefetchRect(UArray2_T array, int x, int y, int w, int h,
+                         bool forWrite)
+{
+        int size = UArray2_size(array);
+        if (x >= UArray2_width(array) || y >= UArray2_height(array)) {
+                return;
+        }
+        if (x + w > UArray2_width(array)) {
+                w = UArray2_width(array) - x;
+        }
+        if (y + h > UArray2_height(array)) {
+                h = UArray2_height(array) - y;
+        }
+        for (int r = 0; r < h; r++) {
+                char *start = (char *) UArray2_row(array, y + r) + x * size;
+                for (int b = 0; b < w * size; b += LINE) {
+                        if (forWrite) {
+                                __builtin_prefetch(start + b, 1);
+                        } else {
+                                __builtin_prefetch(start + b, 0);
+                        }
+                }
+        }
+}
+
+/********** prefetchAhead ********
+ *
+ * Prefetches a source tile of the tiled engine and the destination tile it
+ * will be written to
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform being performed
+ *      UArray2_T src, dst:             the source and destination arrays
+ *      int tx, ty:                     upper left corner of the source tile
+ *      int th:                         height of the current band of tiles
+ *
+ * Return: n/a
+ *
+ ************************/
+static void prefetchAhead(struct transformCl *bundle, UArray2_T src,
+                          UArray2_T dst, int tx, int ty, int th)
+{
+        if (tx >= bundle->width) {
+                return;
+        }
+        int tw = bundle->width - tx < TILE ? bundle->width - tx : TILE;
+        int c0, r0, c1, r1;
+        destination(bundle, tx, ty, &c0, &r0);
+        destination(bundle, tx + tw - 1, ty + th - 1, &c1, &r1);
+
+        prefetchRect(src, tx, ty, tw, th, false);
+        prefetchRect(dst, c0 < c1 ? c0 : c1, r0 < r1 ? r0 : r1,
+                     A2_transform_width(bundle->orientation, tw, th),
+                     A2_transform_height(bundle->orientation, tw, th), true);
+}
+
+/********** transformRows ********
+ *
+ * Transforms a plain array whose rows stay rows (rotations by 0 and 180
+ * degrees and both flips) one whole row at a time: a vertical flip is a
+ * row copy and the others reverse each row with the SIMD reverse kernel
+ *
+ * Parameters:
+ *      UArray2_T src:          the array being transformed
+ *      UArray2_T dst:          the array receiving the result
+ *      int orientation:        A2_ROTATE_0, A2_ROTATE_180 or a flip
+ *
+ * Return: n/a
+ *
+ ************************/
+static void transformRows(UArray2_T src, UArray2_T dst, int orientation)
+{
+        int width = UArray2_width(src);
+        int height = UArray2_height(src);
+        int size = UArray2_size(src);
+        bool stream = streams(dst);
+
+        if (width == 0) {
+                return;
+        }
+        for (int r = 0; r < height; r++) {
+                char *in = UArray2_row(src, r);
+                int to = r;
+                if (orientation == A2_ROTATE_180 ||
+                    orientation == A2_FLIP_VERTICAL) {
+                        to = height - r - 1;
+                }
+                char *out = UArray2_row(dst, to);
+
+                if (orientation == A2_ROTATE_180 ||
+                    orientation == A2_FLIP_HORIZONTAL) {
+                        A2Kernel_reverse(in, out, width, size);
+                } else if (stream) {
+                        streamCopy(out, in, (size_t) width * size);
+                } else {
+                        memcpy(out, in, (size_t) width * size);
+                }
+        }
+        if (stream) {
+                streamFence();
+        }
+}
+
+/********** A2_transform_tiled ********
+ *
+ * Transforms src into dst one TILE x TILE tile at a time. Each source tile is
+ * copied row by row into an aligned scratch buffer, rearranged there, and
+ * written to the destination as whole row segments, so neither array is
+ * ever accessed with a stride of more than one element. Orientations that
+ * keep rows as rows need no tiles and are done one whole row at a time.
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both src and dst
+ *      A2 src:                 the array being transformed
+ *      A2 dst:                 the array receiving the result
+ *      int orientation:        one of the A2_* orientation codes
+ *      int prefetch:           how many tiles ahead to prefetch the source
+ *                              tile and its destination, 0 for none
+ *
+ * Return: n/a
+ *
+ * Expects: the same as A2_transform, and prefetch to be non-negative
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or the scratch
+ *      buffer cannot be allocated
+ *      - The tiles are read through UArray2_row, so only plain arrays are
+ *      tiled; other arrays are transformed by A2_transform_gather
+ *      - Tile rows are written with ordinary stores: at most TILE * size
+ *      bytes each, they would split write-combining buffers if streamed
+ *
+ ************************/
+void A2_transform_tiled(A2Methods_T methods, A2 src, A2 dst, int orientation,
+                        int prefetch)
+{
+        assert(methods != NULL);
+        assert(src != NULL && dst != NULL);
+        assert(prefetch >= 0);
+        checkShapes(methods, src, dst, orientation);
+
+        if (methods != uarray2_methods_plain) {
+                A2_transform_gather(methods, NULL, src, dst, orientation);
+                return;
+        }
+        if (!swapsDimensions(orientation)) {
+                transformRows(src, dst, orientation);
+                return;
+        }
+
+        int width = UArray2_width(src);
+        int height = UArray2_height(src);
+        int size = UArray2_size(src);
+        tilefun *tile = findKernel(size)->tile;
+        struct transformCl bundle = {
+                methods, dst, orientation, width, height, size
+        };
+
+        /* one buffer for the source tile and one for the transformed tile,
+         * each rounded up to whole cache lines */
+        size_t tileBytes = ((size_t) TILE * TILE * size + LINE - 1) / LINE
+                                                                       * LINE;
+        A2Alloc_T alloc = A2Alloc_current();
+        void *scratch = alloc->alloc(alloc, 2 * tileBytes);
+        char *in = scratch;
+        char *out = in + tileBytes;
+
+        for (int ty = 0; ty < height; ty += TILE) {
+                int th = height - ty < TILE ? height - ty : TILE;
+                for (int tx = 0; tx < width; tx += TILE) {
+                        int tw = width - tx < TILE ? width - tx : TILE;
+
+                        if (prefetch > 0) {
+                                prefetchAhead(&bundle, src, dst,
+                                              tx + prefetch * TILE, ty, th);
+                        }
+                        for (int r = 0; r < th; r++) {
+                                char *row = UArray2_row(src, ty + r);
+                                memcpy(in + r * TILE * size, row + tx * size,
+                                                                   tw * size);
+                        }
+                        tile(in, out, tw, th, orientation, size);
+
+                        /* the destination tile starts at the smaller of the
+                         * images of two opposite corners of the source
+                         * tile */
+                        int c0, r0, c1, r1;
+                        destination(&bundle, tx, ty, &c0, &r0);
+                        destination(&bundle, tx + tw - 1, ty + th - 1,
+                                                                   &c1, &r1);
+                        int ox = c0 < c1 ? c0 : c1;
+                        int oy = r0 < r1 ? r0 : r1;
+                        int dw = A2_transform_width(orientation, tw, th);
+                        int dh = A2_transform_height(orientation, tw, th);
+
+                        for (int r = 0; r < dh; r++) {
+                                char *row = UArray2_row(dst, oy + r);
+                                memcpy(row + ox * size, out + r * TILE * size,
+                                       dw * size);
+                        }
+                }
+        }
+
+        alloc->free(alloc, scratch, 2 * tileBytes);
+}
+
+/********** bandTiles ********
+ *
+ * Fills a band of destination rows from a plain source one TILE x TILE
+ * destination tile at a time: the source rectangle landing in the tile is
+ * copied into scratch, rearranged there by the tile kernel and copied into
+ * the band
+ *
+ * Parameters:
+ *      struct transformCl *bundle:     the transform, with the plain source
+ *                                      in other
+ *      int row0:                       the first destination row of the band
+ *      int rows:                       the number of rows in the band
+ *      char *band:                     the band, rows of destination width
+ *                                      elements
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if the scratch buffer cannot be allocated
+ *
+ ************************/
+static void bandTiles(struct transformCl *bundle, int row0, int rows,
+                      char *band)
+{
+        UArray2_T src = bundle->other;
+        int orientation = bundle->orientation;
+        int size = bundle->size;
+        int dstWidth = A2_transform_width(orientation, bundle->width,
+                                          bundle->height);
+        size_t rowBytes = (size_t) dstWidth * size;
+        tilefun *tile = findKernel(size)->tile;
+
+        size_t tileBytes = ((size_t) TILE * TILE * size + LINE - 1) / LINE
+                                                                       * LINE;
+        A2Alloc_T alloc = A2Alloc_current();
+        void *scratch = alloc->alloc(alloc, 2 * tileBytes);
+        char *in = scratch;
+        char *out = in + tileBytes;
+
+        for (int ty = 0; ty < rows; ty += TILE) {
+                int dh = rows - ty < TILE ? rows - ty : TILE;
+                for (int tx = 0; tx < dstWidth; tx += TILE) {
+                        int dw = dstWidth - tx < TILE ? dstWidth - tx : TILE;
+
+                        /* the source rectangle starts at the smaller of the
+                         * origins of two opposite corners of the tile */
+                        int c0, r0, c1, r1;
+                        source(bundle, tx, row0 + ty, &c0, &r0);
+                        source(bundle, tx + dw - 1, row0 + ty + dh - 1,
+                                                                   &c1, &r1);
+                        int sx = c0 < c1 ? c0 : c1;
+                        int sy = r0 < r1 ? r0 : r1;
+                        int sw = swapsDimensions(orientation) ? dh : dw;
+                        int sh = swapsDimensions(orientation) ? dw : dh;
+
+                        for (int r = 0; r < sh; r++) {
+                                char *row = UArray2_row(src, sy + r);
+                                memcpy(in + r * TILE * size, row + sx * size,
+                                                                   sw * size);
+                        }
+                        tile(in, out, sw, sh, orientation, size);
+                        for (int r = 0; r < dh; r++) {
+                                memcpy(band + (ty + r) * rowBytes +
+                                                        (size_t) tx * size,
+                                       out + r * TILE * size, dw * size);
+                        }
+                }
+        }
+
+        alloc->free(alloc, scratch, 2 * tileBytes);
+}
+
+/********** A2_transform_band ********
+ *
+ * Produces a band of consecutive destination rows of a transform without a
+ * destination array, gathering each element from src in output order. Plain
+ * sources are rearranged a tile at a time with the tile kernels; others are
+ * read through at, TILE columns at a time so the source elements read for
+ * one tile column of the band share their cache lines.
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for src
+ *      A2 src:                 the array being transformed
+ *      int orientation:        one of the A2_* orientation codes
+ *      int row0:               the first destination row of the band
+ *      int rows:               the number of destination rows in the band
+ *      void *out:              rows * (destination width) elements, filled
+ *                              row by row
+ *
+ * Return: n/a
+ *
+ * Expects: methods, src and out to not be NULL, orientation to be one of
+ *          the A2_* codes and the band to lie within the destination
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Orientations that keep rows as rows copy or reverse whole source
+ *      rows of plain arrays
+ *
+ ************************/
+void A2_transform_band(A2Methods_T methods, A2 src, int orientation,
+                       int row0, int rows, void *out)
+{
+        assert(methods != NULL && src != NULL && out != NULL);
+
+        int width = methods->width(src);
+        int height = methods->height(src);
+        int size = methods->size(src);
+        int dstWidth = A2_transform_width(orientation, width, height);
+        int dstHeight = A2_transform_height(orientation, width, height);
+        assert(row0 >= 0 && rows >= 0 && row0 + rows <= dstHeight);
+        if (dstWidth == 0) {
+                return;
+        }
+
+        struct transformCl bundle = {
+                methods, src, orientation, width, height, size
+        };
+        bool plain = methods == uarray2_methods_plain;
+        bool blocked = A2_is_blocked(methods);
+        size_t rowBytes = (size_t) dstWidth * size;
+        char *band = out;
+
+        if (plain && !swapsDimensions(orientation)) {
+                for (int r = 0; r < rows; r++) {
+                        int col, row;
+                        source(&bundle, 0, row0 + r, &col, &row);
+                        char *in = UArray2_row(src, row);
+                        if (col == 0) {
+                                memcpy(band + r * rowBytes, in, rowBytes);
+                        } else {
+                                A2Kernel_reverse(in, band + r * rowBytes,
+                                                 dstWidth, size);
+                        }
+                }
+                return;
+        }
+
+        if (plain) {
+                bandTiles(&bundle, row0, rows, band);
+                return;
+        }
+        for (int c0 = 0; c0 < dstWidth; c0 += TILE) {
+                int n = dstWidth - c0 < TILE ? dstWidth - c0 : TILE;
+                for (int r = 0; r < rows; r++) {
+                        char *to = band + r * rowBytes + (size_t) c0 * size;
+                        for (int k = 0; k < n; k++) {
+                                int col, row;
+                                source(&bundle, c0 + k, row0 + r, &col, &row);
+                                memcpy(to + (size_t) k * size,
+                                       blocked ? UArray2b_get(src, col, row)
+                                             : methods->at(src, col, row),
+                                       size);
+                        }
+                }
+        }
+}
+
+/********** A2_transform_from_band ********
+ *
+ * Moves a band of consecutive source rows, held outside any array, to their
+ * transformed positions in dst; the inverse of A2_transform_band, for
+ * producers that never make the whole source. Plain destinations receive a
+ * tile at a time rearranged by the tile kernels; others are written through
+ * at.
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for dst
+ *      const void *in:         rows * width elements of source rows row0 ..
+ *                              row0 + rows - 1, row by row
+ *      int width, height:      the dimensions of the whole source
+ *      int row0:               the first source row of the band
+ *      int rows:               the number of source rows in the band
+ *      A2 dst:                 the array receiving the result
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: n/a
+ *
+ * Expects: methods, in and dst to not be NULL, dst to have the transformed
+ *          dimensions, orientation to be one of the A2_* codes and the band
+ *          to lie within the source
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or the scratch
+ *      buffer cannot be allocated
+ *
+ ************************/
+void A2_transform_from_band(A2Methods_T methods, const void *in, int width,
+                            int height, int row0, int rows, A2 dst,
+                            int orientation)
+{
+        assert(methods != NULL && in != NULL && dst != NULL);
+        assert(row0 >= 0 && rows >= 0 && row0 + rows <= height);
+        assert(methods->width(dst) ==
+               A2_transform_width(orientation, width, height));
+        assert(methods->height(dst) ==
+               A2_transform_height(orientation, width, height));
+        if (width == 0) {
+                return;
+        }
+
+        int size = methods->size(dst);
+        struct transformCl bundle = {
+                methods, dst, orientation, width, height, size
+        };
+        size_t rowBytes = (size_t) width * size;
+        const char *band = in;
+
+        if (methods != uarray2_methods_plain) {
+                for (int r = 0; r < rows; r++) {
+                        const char *row = band + r * rowBytes;
+                        for (int c = 0; c < width; c++) {
+                                int col, to;
+                                destination(&bundle, c, row0 + r, &col, &to);
+                                memcpy(methods->at(dst, col, to),
+                                       row + (size_t) c * size, size);
+                        }
+                }
+                return;
+        }
+        if (!swapsDimensions(orientation)) {
+                for (int r = 0; r < rows; r++) {
+                        int col, to;
+                        destination(&bundle, 0, row0 + r, &col, &to);
+                        char *out = UArray2_row(dst, to);
+                        if (col == 0) {
+                                memcpy(out, band + r * rowBytes, rowBytes);
+                        } else {
+                                A2Kernel_reverse(band + r * rowBytes, out,
+                                                 width, size);
+                        }
+                }
+                return;
+        }
+
+        tilefun *tile = findKernel(size)->tile;
+        size_t tileBytes = ((size_t) TILE * TILE * size + LINE - 1) / LINE
+                                                                       * LINE;
+        A2Alloc_T alloc = A2Alloc_current();
+        void *scratch = alloc->alloc(alloc, 2 * tileBytes);
+        char *tin = scratch;
+        char *tout = tin + tileBytes;
+
+        for (int ty = 0; ty < rows; ty += TILE) {
+                int th = rows - ty < TILE ? rows - ty : TILE;
+                for (int tx = 0; tx < width; tx += TILE) {
+                        int tw = width - tx < TILE ? width - tx : TILE;
+                        for (int r = 0; r < th; r++) {
+                                memcpy(tin + r * TILE * size,
+                                       band + (ty + r) * rowBytes +
+                                                        (size_t) tx * size,
+                                       tw * size);
+                        }
+                        tile(tin, tout, tw, th, orientation, size);
+
+                        int c0, r0, c1, r1;
+                        destination(&bundle, tx, row0 + ty, &c0, &r0);
+                        destination(&bundle, tx + tw - 1, row0 + ty + th - 1,
+                                                                   &c1, &r1);
+                        int ox = c0 < c1 ? c0 : c1;
+                        int oy = r0 < r1 ? r0 : r1;
+                        for (int r = 0; r < tw; r++) {
+                                char *row = UArray2_row(dst, oy + r);
+                                memcpy(row + ox * size, tout + r * TILE * size,
+                                                                   th * size);
+                        }
+                }
+        }
+
+        alloc->free(alloc, scratch, 2 * tileBytes);
+}
+
+/********** A2_plan_direction ********
+ *
+ * Picks whether a transform should traverse the source or the destination
+ *
+ * Parameters:
+ *      A2Methods_T methods:    the methods for both arrays
+ *      A2Methods_mapfun *map:  the map that will be used for the traversal
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: A2_SCATTER, A2_GATHER or A2_TILED
+ *
+ * Notes:
+ *      - Plain arrays use the tiled engine, which also copies or reverses
+ *      whole rows for orientations that keep rows as rows, unless the map
+ *      is column-major
+ *      - Otherwise orientations that keep rows as rows touch both arrays in
+ *      storage order either way, so they scatter. 90, 270 and transpose
+ *      move rows to columns; the planner then traverses whichever array
+ *      lets the writes stream, which for row-major and block-major maps is
+ *      the destination.
+ *
+ ************************/
+int A2_plan_direction(A2Methods_T methods, A2Methods_mapfun *map,
+                      int orientation)
+{
+        assert(methods != NULL);
+
+        bool colMajor = map != NULL && map == methods->map_col_major;
+        if (methods == uarray2_methods_plain && !colMajor) {
+                return A2_TILED;
+        }
+        if (!swapsDimensions(orientation) || colMajor) {
+                return A2_SCATTER;
+        }
+        return A2_GATHER;
+}
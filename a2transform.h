@@ -0,0 +1,68 @@
+/**************************************************************
+ *
+ *                     a2transform.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for geometric transforms (rotations, flips and
+ *              transposition) between two A2 arrays of any element size. The
+ *              copy of each element is specialized for common element sizes
+ *              so the same engine serves grayscale maps, packed RGB, Pnm_rgb
+ *              pixels and other per-cell records.
+ *
+ **************************************************************/
+
+#ifndef A2TRANSFORM_INCLUDED
+#define A2TRANSFORM_INCLUDED
+
+#include <stddef.h>
+#include "a2methods.h"
+
+/* Orientation codes understood by A2_transform; rotations are clockwise */
+#define A2_ROTATE_0             0
+#define A2_ROTATE_90            90
+#define A2_ROTATE_180           180
+#define A2_ROTATE_270           270
+#define A2_FLIP_HORIZONTAL      1       /* mirror left-right */
+#define A2_FLIP_VERTICAL        2       /* mirror top-bottom */
+#define A2_TRANSPOSE            3       /* mirror across UL-to-LR axis */
+
+/* Which array a transform traverses, as chosen by A2_plan_direction */
+#define A2_SCATTER              0       /* traverse source, write anywhere */
+#define A2_GATHER               1       /* traverse destination, read
+                                         * anywhere */
+#define A2_TILED                2       /* rearrange tiles in a scratch
+                                         * buffer */
+
+extern int A2_transform_width (int orientation, int width, int height);
+extern int A2_transform_height(int orientation, int width, int height);
+
+extern void A2_transform(A2Methods_T methods, A2Methods_mapfun *map,
+                         A2Methods_UArray2 src, A2Methods_UArray2 dst,
+                         int orientation);
+extern void A2_transform_gather(A2Methods_T methods, A2Methods_mapfun *map,
+                                A2Methods_UArray2 src, A2Methods_UArray2 dst,
+                                int orientation);
+extern void A2_transform_tiled(A2Methods_T methods, A2Methods_UArray2 src,
+                               A2Methods_UArray2 dst, int orientation,
+                               int prefetch);
+
+/* fills out with destination rows row0 .. row0 + rows - 1 of src transformed,
+ * without making the destination */
+extern void A2_transform_band(A2Methods_T methods, A2Methods_UArray2 src,
+                              int orientation, int row0, int rows, void *out);
+
+/* moves source rows row0 .. row0 + rows - 1, held in in, to their places in
+ * dst, without making the source */
+extern void A2_transform_from_band(A2Methods_T methods, const void *in,
+                                   int width, int height, int row0, int rows,
+                                   A2Methods_UArray2 dst, int orientation);
+
+extern void A2_set_stream_threshold(size_t bytes);
+
+extern int A2_plan_direction(A2Methods_T methods, A2Methods_mapfun *map,
+                             int orientation);
+
+#endif
@@ -0,0 +1,1014 @@
+/**************************************************************
+ *
+ *                     ppmio.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of mapped P6 PPM input and buffered
+ *              output. The header is parsed from the mapping, and the raster
+ *              is converted row by row with the parse kernels into plain
+ *              arrays, or pixel by pixel in the order of the default map into
+ *              other arrays, or a band of rows at a time into its place in
+ *              a transformed array. Output is formatted with the format
+ *              kernels into a buffer of a few megabytes: plain arrays a row
+ *              at a time, blocked arrays a band of one block row at a time,
+ *              the band being copied out block by block first, and
+ *              transformed output a band of rows gathered by
+ *              A2_transform_band at a time. Flips and 180 degree rotations
+ *              can also be streamed straight from the mapping one row at a
+ *              time, and rotations of images larger than memory are done out
+ *              of core through a temporary file of tiles. Buffers come from
+ *              the calling thread's allocator (a2alloc.h).
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "assert.h"
+#include "ppmio.h"
+#include "a2kernels.h"
+#include "a2transform.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2rect.h"
+#include "a2alloc.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+
+#define T Ppmio_T
+
+#define LINE 64                         /* bytes in a cache line */
+#define BUFFER ((size_t) 4 << 20)       /* bytes of raster per write */
+#define BAND 16                         /* output rows gathered at once */
+#define SPILL_DIR "/var/tmp"            /* for tiles, unless TMPDIR is set */
+
+typedef A2Methods_UArray2 A2;
+
+struct T {
+        char *mapping;          /* the whole file */
+        size_t length;          /* bytes in the file */
+        const char *raster;     /* the first sample of the first pixel */
+        unsigned width;
+        unsigned height;
+        unsigned denominator;
+        int depth;              /* bytes per raster sample, 1 or 2 */
+};
+
+/*
+ * Struct to pass the input being converted into parseOne.
+ */
+struct parseCl {
+        T input;
+        int size;               /* bytes per pixel of the array */
+};
+
+/********** headerNumber ********
+ *
+ * Reads one decimal number of a PPM header, skipping the whitespace and
+ * comments before it
+ *
+ * Parameters:
+ *      const char **p:         the next unread header byte, moved past the
+ *                              number
+ *      const char *end:        one past the last byte of the file
+ *      unsigned *number:       where the number goes
+ *
+ * Return: true if a number no greater than 2^31 - 1 was read
+ *
+ ************************/
+static bool headerNumber(const char **p, const char *end, unsigned *number)
+{
+        const char *at = *p;
+
+        while (at < end && (isspace((unsigned char) *at) || *at == '#')) {
+                if (*at == '#') {
+                        while (at < end && *at != '\n') {
+                                at++;
+                        }
+                } else {
+                        at++;
+                }
+        }
+        if (at == end || !isdigit((unsigned char) *at)) {
+                return false;
+        }
+        unsigned long value = 0;
+        while (at < end && isdigit((unsigned char) *at)) {
+                value = value * 10 + (*at - '0');
+                if (value > INT32_MAX) {
+                        return false;
+                }
+                at++;
+        }
+        *number = value;
+        *p = at;
+        return true;
+}
+
+/********** Ppmio_open ********
+ *
+ * Maps the file behind fp into memory and parses its P6 header
+ *
+ * Parameters:
+ *      FILE *fp:       an open file positioned at the start of the image
+ *
+ * Return: the mapped image, or NULL if fp is not a regular file or does not
+ *         hold a complete P6 image; nothing is read from fp either way
+ *
+ * Expects: fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if fp is NULL or memory cannot be allocated
+ *      - Pipes and terminals give NULL, so callers fall back to
+ *      Pnm_ppmread
+ *      - The caller frees the result with Ppmio_close
+ *
+ ************************/
+T Ppmio_open(FILE *fp)
+{
+        assert(fp != NULL);
+
+        struct stat info;
+        int fd = fileno(fp);
+        if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+            info.st_size < 2) {
+                return NULL;
+        }
+        size_t length = info.st_size;
+        char *mapping = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+                return NULL;
+        }
+
+        const char *p = mapping + 2;
+        const char *end = mapping + length;
+        unsigned width, height, denominator;
+        if (mapping[0] != 'P' || mapping[1] != '6' ||
+            !headerNumber(&p, end, &width) ||
+            !headerNumber(&p, end, &height) ||
+            !headerNumber(&p, end, &denominator) ||
+            p == end || !isspace((unsigned char) *p) ||
+            width == 0 || height == 0 ||
+            denominator == 0 || denominator > 65535) {
+                munmap(mapping, length);
+                return NULL;
+        }
+        p++;            /* the single whitespace ending the header */
+
+        int depth = denominator <= 255 ? 1 : 2;
+        if ((size_t) (end - p) / 3 / depth / width < height) {
+                munmap(mapping, length);        /* raster is cut short */
+                return NULL;
+        }
+        madvise(mapping, length, MADV_SEQUENTIAL);
+
+        T input = malloc(sizeof(*input));
+        assert(input != NULL);
+        input->mapping = mapping;
+        input->length = length;
+        input->raster = p;
+        input->width = width;
+        input->height = height;
+        input->denominator = denominator;
+        input->depth = depth;
+        return input;
+}
+
+/********** Ppmio_close ********
+ *
+ * Unmaps an image opened with Ppmio_open
+ *
+ * Parameters:
+ *      T *input:       a pointer to the image, set to NULL afterwards
+ *
+ * Return: n/a
+ *
+ * Expects: input and *input to not be NULL, and every view read from it to
+ *          have been freed
+ *
+ * Notes:
+ *      - Calls CRE if input or *input is NULL
+ *
+ ************************/
+void Ppmio_close(T *input)
+{
+        assert(input != NULL && *input != NULL);
+
+        munmap((*input)->mapping, (*input)->length);
+        free(*input);
+        *input = NULL;
+}
+
+/********** Ppmio_width, Ppmio_height, Ppmio_denominator ********
+ *
+ * Get the width, height and maxval from the header of a mapped image
+ *
+ * Parameters:
+ *      T input:        the image
+ *
+ * Return: the requested header field
+ *
+ * Expects: input to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if input is NULL
+ *
+ ************************/
+unsigned Ppmio_width(T input)
+{
+        assert(input != NULL);
+        return input->width;
+}
+
+unsigned Ppmio_height(T input)
+{
+        assert(input != NULL);
+        return input->height;
+}
+
+unsigned Ppmio_denominator(T input)
+{
+        assert(input != NULL);
+        return input->denominator;
+}
+
+/********** parseOne ********
+ *
+ * Apply function that converts the raster pixel at (i, j) into the element
+ * at (i, j)
+ *
+ * Parameters:
+ *      int i, j:               column and row of the pixel
+ *      A2 pixels:              the array being filled
+ *      void *elem:             the element
+ *      void *cl:               a struct parseCl
+ *
+ * Return: n/a
+ *
+ ************************/
+static void parseOne(int i, int j, A2 pixels, void *elem, void *cl)
+{
+        struct parseCl *bundle = cl;
+        T input = bundle->input;
+        size_t pixel = (size_t) j * input->width + i;
+        (void) pixels;
+
+        A2Kernel_parse(input->raster + pixel * 3 * input->depth, elem, 1,
+                       input->depth, bundle->size);
+}
+
+/********** Ppmio_read ********
+ *
+ * Makes a Pnm_ppm of a mapped image with the requested methods and pixel
+ * layout
+ *
+ * Parameters:
+ *      T input:                the image
+ *      A2Methods_T methods:    the methods for the pixel array
+ *      int size:               bytes per pixel: 3 * depth for the raster's
+ *                              own layout, 4 * depth for packed pixels or
+ *                              12 for struct Pnm_rgb, where depth is 1 for
+ *                              a maxval up to 255 and 2 otherwise
+ *
+ * Return: a new Pnm_ppm, which the caller frees with Pnm_ppmfree
+ *
+ * Expects: input and methods to not be NULL and size to be one of the sizes
+ *          listed for the image's maxval
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *      be allocated
+ *      - With plain methods and the raster's own layout the pixels are a
+ *      view of the mapped file, so nothing is copied; it must be freed
+ *      before input is closed
+ *
+ ************************/
+Pnm_ppm Ppmio_read(T input, A2Methods_T methods, int size)
+{
+        assert(input != NULL && methods != NULL);
+        int depth = input->depth;
+        assert(size == 3 * depth || size == 4 * depth || size == 12);
+
+        int width = input->width;
+        int height = input->height;
+        A2 pixels;
+
+        if (methods == uarray2_methods_plain && size == 3 * depth) {
+                pixels = UArray2_view(width, height, size,
+                                      (char *) input->raster);
+        } else if (methods == uarray2_methods_plain) {
+                pixels = methods->new(width, height, size);
+                size_t stride = (size_t) width * 3 * depth;
+                for (int r = 0; r < height; r++) {
+                        A2Kernel_parse(input->raster + r * stride,
+                                       UArray2_row(pixels, r), width, depth,
+                                       size);
+                }
+        } else {
+                pixels = methods->new(width, height, size);
+                struct parseCl bundle = { input, size };
+                methods->map_default(pixels, parseOne, &bundle);
+        }
+
+        Pnm_ppm image = malloc(sizeof(*image));
+        assert(image != NULL);
+        image->width = width;
+        image->height = height;
+        image->denominator = input->denominator;
+        image->pixels = pixels;
+        image->methods = methods;
+        return image;
+}
+
+/********** Ppmio_read_transformed ********
+ *
+ * Makes a Pnm_ppm of a mapped image already rotated, flipped or transposed:
+ * the raster is parsed a band of rows at a time and every band is moved
+ * straight to its transformed position, so the untransformed image is never
+ * made
+ *
+ * Parameters:
+ *      T input:                the image
+ *      A2Methods_T methods:    the methods for the pixel array
+ *      int size:               bytes per pixel, as for Ppmio_read
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: a new Pnm_ppm with the transformed dimensions, which the caller
+ *         frees with Pnm_ppmfree
+ *
+ * Expects: the same as Ppmio_read, and orientation to be one of the A2_*
+ *          codes
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *      be allocated
+ *      - The pixels are always a copy, even in the raster's own layout
+ *
+ ************************/
+Pnm_ppm Ppmio_read_transformed(T input, A2Methods_T methods, int size,
+                               int orientation)
+{
+        assert(input != NULL && methods != NULL);
+        int depth = input->depth;
+        assert(size == 3 * depth || size == 4 * depth || size == 12);
+
+        int width = input->width;
+        int height = input->height;
+        A2 pixels = methods->new(A2_transform_width(orientation, width,
+                                                    height),
+                                 A2_transform_height(orientation, width,
+                                                     height), size);
+        A2Alloc_T alloc = A2Alloc_current();
+        size_t stageBytes = (size_t) width * BAND * size;
+        char *stage = alloc->alloc(alloc, stageBytes);
+        size_t stride = (size_t) width * 3 * depth;
+
+        for (int r0 = 0; r0 < height; r0 += BAND) {
+                int rows = height - r0 < BAND ? height - r0 : BAND;
+                for (int r = 0; r < rows; r++) {
+                        A2Kernel_parse(input->raster + (r0 + r) * stride,
+                                       stage + (size_t) r * width * size,
+                                       width, depth, size);
+                }
+                A2_transform_from_band(methods, stage, width, height, r0,
+                                       rows, pixels, orientation);
+        }
+        alloc->free(alloc, stage, stageBytes);
+
+        Pnm_ppm image = malloc(sizeof(*image));
+        assert(image != NULL);
+        image->width = methods->width(pixels);
+        image->height = methods->height(pixels);
+        image->denominator = input->denominator;
+        image->pixels = pixels;
+        image->methods = methods;
+        return image;
+}
+
+/********** writeAll ********
+ *
+ * Writes every byte described by an array of iovecs, resuming after
+ * partial writes and interruptions
+ *
+ * Parameters:
+ *      int fd:                 the file descriptor written to
+ *      struct iovec *iov:      the buffers; they are consumed in place
+ *      int count:              the number of buffers
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if a write fails
+ *
+ ************************/
+static void writeAll(int fd, struct iovec *iov, int count)
+{
+        while (count > 0) {
+                ssize_t written = writev(fd, iov, count);
+                if (written < 0 && errno == EINTR) {
+                        continue;
+                }
+                assert(written >= 0);
+
+                while (count > 0 && (size_t) written >= iov->iov_len) {
+                        written -= iov->iov_len;
+                        iov++;
+                        count--;
+                }
+                if (count > 0) {
+                        iov->iov_base = (char *) iov->iov_base + written;
+                        iov->iov_len -= written;
+                }
+        }
+}
+
+/*
+ * The state of one image being written: the header until it is written and
+ * a buffer of formatted raster rows.
+ */
+struct writer {
+        int fd;
+        char header[64];
+        size_t headerLength;    /* 0 once the header is written */
+        char *buffer;
+        size_t capacity;        /* bytes the buffer holds */
+        A2Alloc_T alloc;        /* the allocator the buffer came from */
+        size_t used;            /* bytes formatted and not yet written */
+        int width;              /* pixels per row */
+        int depth;              /* bytes per raster sample, 1 or 2 */
+        int size;               /* bytes per pixel handed to writerRow */
+};
+
+/********** writerOpen ********
+ *
+ * Starts writing a P6 image to fp
+ *
+ * Parameters:
+ *      struct writer *w:       the writer to set up
+ *      FILE *fp:               where the image goes; it is flushed and then
+ *                              written through its file descriptor
+ *      int width, height:      the dimensions of the image
+ *      unsigned denominator:   the maxval of the image
+ *      int size:               bytes per pixel of the rows to come
+ *      int rows:               rows the buffer must hold at once
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if size does not suit the maxval or the buffer cannot be
+ *      allocated
+ *
+ ************************/
+static void writerOpen(struct writer *w, FILE *fp, int width, int height,
+                       unsigned denominator, int size, int rows)
+{
+        w->depth = denominator <= 255 ? 1 : 2;
+        assert(size == 3 * w->depth || size == 4 * w->depth || size == 12);
+
+        fflush(fp);
+        w->fd = fileno(fp);
+        w->headerLength = snprintf(w->header, sizeof(w->header),
+                                   "P6\n%d %d\n%u\n", width, height,
+                                   denominator);
+        w->width = width;
+        w->size = size;
+        w->used = 0;
+
+        size_t bytes = (size_t) width * 3 * w->depth * rows;
+        w->capacity = bytes > BUFFER ? bytes : BUFFER;
+        w->alloc = A2Alloc_current();
+        w->buffer = w->alloc->alloc(w->alloc, w->capacity);
+}
+
+/********** writerFlush ********
+ *
+ * Writes the header, if it has not been written yet, and the formatted rows
+ * in the buffer with one writev
+ *
+ * Parameters:
+ *      struct writer *w:       the writer
+ *
+ * Return: n/a
+ *
+ ************************/
+static void writerFlush(struct writer *w)
+{
+        struct iovec iov[2];
+        int count = 0;
+
+        if (w->headerLength > 0) {
+                iov[count].iov_base = w->header;
+                iov[count].iov_len = w->headerLength;
+                count++;
+                w->headerLength = 0;
+        }
+        if (w->used > 0) {
+                iov[count].iov_base = w->buffer;
+                iov[count].iov_len = w->used;
+                count++;
+        }
+        writeAll(w->fd, iov, count);
+        w->used = 0;
+}
+
+/********** writerRows ********
+ *
+ * Formats rows of pixels into the buffer, writing the buffer out first if
+ * they do not fit
+ *
+ * Parameters:
+ *      struct writer *w:       the writer
+ *      const char *pixels:     the first pixel of the first row
+ *      size_t stride:          bytes from one row to the next
+ *      int rows:               the number of rows, at most the rows given
+ *                              to writerOpen
+ *
+ * Return: n/a
+ *
+ ************************/
+static void writerRows(struct writer *w, const char *pixels, size_t stride,
+                       int rows)
+{
+        size_t rowBytes = (size_t) w->width * 3 * w->depth;
+
+        if (w->used + rows * rowBytes > w->capacity) {
+                writerFlush(w);
+        }
+        for (int r = 0; r < rows; r++) {
+                A2Kernel_format(pixels + r * stride, w->buffer + w->used,
+                                w->width, w->depth, w->size);
+                w->used += rowBytes;
+        }
+}
+
+/********** writerClose ********
+ *
+ * Writes whatever is left and frees the buffer
+ *
+ * Parameters:
+ *      struct writer *w:       the writer
+ *
+ * Return: n/a
+ *
+ ************************/
+static void writerClose(struct writer *w)
+{
+        writerFlush(w);
+        w->alloc->free(w->alloc, w->buffer, w->capacity);
+}
+
+/********** Ppmio_write ********
+ *
+ * Writes an image as a binary (P6) PPM, bypassing stdio
+ *
+ * Parameters:
+ *      FILE *fp:       where the image goes
+ *      Pnm_ppm image:  the image; its pixels may be 3 or 6 byte raster
+ *                      pixels, 4 or 8 byte packed pixels or Pnm_rgb structs,
+ *                      in an array of any A2 backend
+ *
+ * Return: n/a
+ *
+ * Expects: fp, image and its pixels and methods to not be NULL, and the
+ *          pixels to have one of the sizes listed for the image's maxval
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated, memory cannot be
+ *      allocated or a write fails
+ *      - fp is flushed first and written through its file descriptor, so
+ *      output already buffered in fp comes out first
+ *      - Rows go out in chunks of a few megabytes; a band of blocked rows
+ *      larger than that goes out whole
+ *
+ ************************/
+void Ppmio_write(FILE *fp, Pnm_ppm image)
+{
+        assert(fp != NULL && image != NULL);
+        assert(image->pixels != NULL && image->methods != NULL);
+
+        A2Methods_T methods = (A2Methods_T) image->methods;
+        A2 pixels = image->pixels;
+        int width = image->width;
+        int height = image->height;
+        int size = methods->size(pixels);
+        bool plain = methods == uarray2_methods_plain;
+        bool blocked = A2_is_blocked(methods);
+        int band = plain ? 1 : methods->blocksize(pixels);
+        int across = blocked ? UArray2b_block_width(pixels) : band;
+
+        struct writer w;
+        writerOpen(&w, fp, width, height, image->denominator, size, band);
+        A2Alloc_T alloc = A2Alloc_current();
+        size_t stageBytes = (size_t) width * band * size;
+        char *stage = plain ? NULL : alloc->alloc(alloc, stageBytes);
+
+        for (int r0 = 0; r0 < height && width > 0; r0 += band) {
+                int rows = height - r0 < band ? height - r0 : band;
+                if (plain) {
+                        writerRows(&w, UArray2_row(pixels, r0), 0, 1);
+                        continue;
+                }
+                /* copy the band out one block at a time */
+                for (int c0 = 0; c0 < width; c0 += across) {
+                        int cols = width - c0 < across ? width - c0 : across;
+                        for (int r = 0; r < rows; r++) {
+                                char *to = stage + ((size_t) r * width + c0)
+                                                                       * size;
+                                for (int c = 0; c < cols; c++) {
+                                        memcpy(to + (size_t) c * size,
+                                               blocked
+                                               ? UArray2b_get(pixels, c0 + c,
+                                                              r0 + r)
+                                               : methods->at(pixels, c0 + c,
+                                                             r0 + r), size);
+                                }
+                        }
+                }
+                writerRows(&w, stage, (size_t) width * size, rows);
+        }
+        writerClose(&w);
+        if (stage != NULL) {
+                alloc->free(alloc, stage, stageBytes);
+        }
+}
+
+/********** Ppmio_write_transformed ********
+ *
+ * Writes an image rotated, flipped or transposed as a binary (P6) PPM
+ * without ever making the transformed image: the output rows are gathered
+ * from the source a band at a time, formatted and written
+ *
+ * Parameters:
+ *      FILE *fp:               where the image goes
+ *      Pnm_ppm image:          the untransformed image, with pixels as for
+ *                              Ppmio_write
+ *      int orientation:        one of the A2_* orientation codes
+ *
+ * Return: n/a
+ *
+ * Expects: the same as Ppmio_write, and orientation to be one of the A2_*
+ *          codes
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated, memory cannot be
+ *      allocated or a write fails
+ *      - Only a band of BAND output rows is held besides the image
+ *
+ ************************/
+void Ppmio_write_transformed(FILE *fp, Pnm_ppm image, int orientation)
+{
+        assert(fp != NULL && image != NULL);
+        assert(image->pixels != NULL && image->methods != NULL);
+
+        A2Methods_T methods = (A2Methods_T) image->methods;
+        A2 pixels = image->pixels;
+        int size = methods->size(pixels);
+        int width = A2_transform_width(orientation, image->width,
+                                       image->height);
+        int height = A2_transform_height(orientation, image->width,
+                                         image->height);
+
+        struct writer w;
+        writerOpen(&w, fp, width, height, image->denominator, size, BAND);
+        A2Alloc_T alloc = A2Alloc_current();
+        size_t stageBytes = (size_t) width * BAND * size;
+        char *stage = width > 0 ? alloc->alloc(alloc, stageBytes) : NULL;
+
+        for (int r0 = 0; r0 < height && width > 0; r0 += BAND) {
+                int rows = height - r0 < BAND ? height - r0 : BAND;
+                A2_transform_band(methods, pixels, orientation, r0, rows,
+                                                                       stage);
+                writerRows(&w, stage, (size_t) width * size, rows);
+        }
+        writerClose(&w);
+        if (stage != NULL) {
+                alloc->free(alloc, stage, stageBytes);
+        }
+}
+
+/********** release ********
+ *
+ * Lets the kernel drop the pages of a range of the mapping that will not be
+ * read again, so streaming a huge file keeps only a window of it resident
+ *
+ * Parameters:
+ *      const char *from:       the first byte of the range
+ *      const char *to:         one past the last byte of the range
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Only the whole pages inside the range are dropped; the mapping is
+ *      private and never written here, so dropped pages are read again
+ *      from the file if they are touched
+ *
+ ************************/
+static void release(const char *from, const char *to)
+{
+        uintptr_t page = sysconf(_SC_PAGESIZE);
+        uintptr_t start = ((uintptr_t) from + page - 1) / page * page;
+        uintptr_t end = (uintptr_t) to / page * page;
+
+        if (start < end) {
+                madvise((void *) start, end - start, MADV_DONTNEED);
+        }
+}
+
+/********** Ppmio_stream ********
+ *
+ * Writes a mapped image flipped, rotated by 180 degrees or unchanged
+ * straight from the mapping, one row at a time, without making any array
+ *
+ * Parameters:
+ *      FILE *fp:               where the image goes
+ *      T input:                the image
+ *      int orientation:        A2_ROTATE_0, A2_ROTATE_180,
+ *                              A2_FLIP_HORIZONTAL or A2_FLIP_VERTICAL
+ *
+ * Return: n/a
+ *
+ * Expects: fp and input to not be NULL and orientation to be one of the
+ *          four listed, all of which keep rows as rows
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated, memory cannot be
+ *      allocated or a write fails
+ *      - Rows are reversed straight into the output buffer, so nothing but
+ *      that buffer is allocated; rows already streamed are dropped from
+ *      memory as the stream moves on, which lets images far larger than
+ *      memory be flipped
+ *
+ ************************/
+void Ppmio_stream(FILE *fp, T input, int orientation)
+{
+        assert(fp != NULL && input != NULL);
+        assert(orientation == A2_ROTATE_0 || orientation == A2_ROTATE_180 ||
+               orientation == A2_FLIP_HORIZONTAL ||
+               orientation == A2_FLIP_VERTICAL);
+
+        int width = input->width;
+        int height = input->height;
+        int size = 3 * input->depth;
+        size_t stride = (size_t) width * size;
+        bool upward = orientation == A2_ROTATE_180 ||
+                      orientation == A2_FLIP_VERTICAL;
+        bool reverse = orientation == A2_ROTATE_180 ||
+                       orientation == A2_FLIP_HORIZONTAL;
+
+        struct writer w;
+        writerOpen(&w, fp, width, height, input->denominator, size, 1);
+        if (upward) {
+                madvise(input->mapping, input->length, MADV_NORMAL);
+        }
+
+        const char *done = upward ? input->raster + height * stride
+                                  : input->raster;
+        for (int r = 0; r < height; r++) {
+                const char *in = input->raster +
+                                 (upward ? height - 1 - r : r) * stride;
+                if (reverse) {
+                        if (w.used + stride > w.capacity) {
+                                writerFlush(&w);
+                        }
+                        A2Kernel_reverse(in, w.buffer + w.used, width, size);
+                        w.used += stride;
+                } else {
+                        writerRows(&w, in, 0, 1);
+                }
+
+                /* drop what was streamed once a buffer's worth has built up */
+                if (upward && done - in >= (ptrdiff_t) BUFFER) {
+                        release(in, done);
+                        done = in;
+                } else if (!upward && in + stride - done >=
+                                                       (ptrdiff_t) BUFFER) {
+                        release(done, in + stride);
+                        done = in + stride;
+                }
+        }
+        writerClose(&w);
+}
+
+/********** spillFile ********
+ *
+ * Makes an anonymous temporary file for tiles that do not fit in memory
+ *
+ * Parameters: none
+ *
+ * Return: the file descriptor of the file, which has already been unlinked
+ *         so it disappears when closed
+ *
+ * Notes:
+ *      - The file goes in $TMPDIR, or SPILL_DIR if that is not set, since
+ *      /tmp is often kept in memory
+ *      - Calls CRE if the file cannot be made
+ *
+ ************************/
+static int spillFile(void)
+{
+        const char *dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') {
+                dir = SPILL_DIR;
+        }
+        char path[4096];
+        int length = snprintf(path, sizeof(path), "%s/ppmtrans.XXXXXX", dir);
+        assert(length > 0 && (size_t) length < sizeof(path));
+
+        int fd = mkstemp(path);
+        assert(fd >= 0);
+        unlink(path);
+        return fd;
+}
+
+/********** spill ********
+ *
+ * Writes n bytes to a temporary file at an offset, resuming after partial
+ * writes and interruptions
+ *
+ * Parameters:
+ *      int fd:                 the file
+ *      const char *bytes:      the bytes
+ *      size_t n:               how many there are
+ *      off_t offset:           where they go in the file
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if a write fails, e.g. because the disk is full
+ *
+ ************************/
+static void spill(int fd, const char *bytes, size_t n, off_t offset)
+{
+        while (n > 0) {
+                ssize_t written = pwrite(fd, bytes, n, offset);
+                if (written < 0 && errno == EINTR) {
+                        continue;
+                }
+                assert(written > 0);
+                bytes += written;
+                offset += written;
+                n -= written;
+        }
+}
+
+/********** unspill ********
+ *
+ * Reads n bytes back from a temporary file at an offset
+ *
+ * Parameters:
+ *      int fd:                 the file
+ *      char *bytes:            where the bytes go
+ *      size_t n:               how many to read
+ *      off_t offset:           where they are in the file
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if a read fails or the file ends first
+ *
+ ************************/
+static void unspill(int fd, char *bytes, size_t n, off_t offset)
+{
+        while (n > 0) {
+                ssize_t got = pread(fd, bytes, n, offset);
+                if (got < 0 && errno == EINTR) {
+                        continue;
+                }
+                assert(got > 0);
+                bytes += got;
+                offset += got;
+                n -= got;
+        }
+}
+
+/********** Ppmio_transform_out_of_core ********
+ *
+ * Writes a mapped image rotated by 90 or 270 degrees or transposed while
+ * holding only a band of it in memory at a time
+ *
+ * Parameters:
+ *      FILE *fp:               where the image goes
+ *      T input:                the image
+ *      int orientation:        A2_ROTATE_90, A2_ROTATE_270 or A2_TRANSPOSE
+ *      size_t budget:          the bytes of memory the rotation may use
+ *
+ * Return: n/a
+ *
+ * Expects: fp and input to not be NULL and orientation to be one of the
+ *          three listed, all of which turn rows into columns
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated, memory cannot be
+ *      allocated or the temporary file cannot be made, written or read
+ *      - Runs in two passes over a temporary file (see spillFile) as big as
+ *      the image. The first reads the source a band of rows at a time,
+ *      transforms each band with A2_transform_tiled into a strip of
+ *      destination columns and cuts the strip into tiles, one per band of
+ *      destination rows; each tile is written where it belongs in the file,
+ *      which holds the destination band after band with the tiles of a
+ *      band side by side. The second reads the destination back a band at
+ *      a time, sequentially, and joins the rows of its tiles as they are
+ *      written out.
+ *      - Bands are as many rows as fit twice in what the budget leaves
+ *      after the output buffer, rounded down to a multiple of BAND and never
+ *      fewer than BAND, so a tiny budget is exceeded rather than refused
+ *
+ ************************/
+void Ppmio_transform_out_of_core(FILE *fp, T input, int orientation,
+                                 size_t budget)
+{
+        assert(fp != NULL && input != NULL);
+        assert(orientation == A2_ROTATE_90 || orientation == A2_ROTATE_270 ||
+               orientation == A2_TRANSPOSE);
+
+        int width = input->width;
+        int height = input->height;
+        int size = 3 * input->depth;
+        size_t stride = (size_t) width * size;
+        int dstWidth = height;
+        int dstHeight = width;
+        size_t dstStride = (size_t) dstWidth * size;
+
+        /* one band buffer serves both passes, so it must hold a band of
+         * whichever of the source and destination rows is longer; the
+         * first pass also has a band of the mapping resident, the second
+         * the output buffer */
+        size_t longest = stride > dstStride ? stride : dstStride;
+        size_t most = width > height ? width : height;
+        size_t fit = budget > BUFFER ? (budget - BUFFER) / (2 * longest) : 0;
+        fit = fit < most ? fit : most;
+        int band = fit < BAND ? BAND : (int) (fit / BAND * BAND);
+
+        A2Alloc_T alloc = A2Alloc_current();
+        char *buffer = alloc->alloc(alloc, band * longest);
+        int fd = spillFile();
+
+        for (int r0 = 0; r0 < height; r0 += band) {
+                int rows = height - r0 < band ? height - r0 : band;
+                const char *in = input->raster + r0 * stride;
+                UArray2_T src = UArray2_view(width, rows, size, (void *) in);
+                UArray2_T strip = UArray2_view(rows, width, size, buffer);
+                A2_transform_tiled(uarray2_methods_plain, src, strip,
+                                   orientation, 0);
+                UArray2_free(&src);
+                UArray2_free(&strip);
+
+                /* the first destination column the strip fills */
+                int x0 = orientation == A2_ROTATE_90 ? height - r0 - rows
+                                                     : r0;
+                for (int y0 = 0; y0 < dstHeight; y0 += band) {
+                        int tileRows = dstHeight - y0 < band ? dstHeight - y0
+                                                             : band;
+                        spill(fd, buffer + (size_t) y0 * rows * size,
+                              (size_t) tileRows * rows * size,
+                              ((off_t) y0 * dstWidth +
+                               (off_t) tileRows * x0) * size);
+                }
+                release(in, in + rows * stride);
+        }
+
+        struct writer w;
+        writerOpen(&w, fp, dstWidth, dstHeight, input->denominator, size, 1);
+        for (int y0 = 0; y0 < dstHeight; y0 += band) {
+                int tileRows = dstHeight - y0 < band ? dstHeight - y0 : band;
+                unspill(fd, buffer, tileRows * dstStride,
+                        (off_t) y0 * dstStride);
+
+                for (int r = 0; r < tileRows; r++) {
+                        if (w.used + dstStride > w.capacity) {
+                                writerFlush(&w);
+                        }
+                        char *out = w.buffer + w.used;
+                        for (int r0 = 0; r0 < height; r0 += band) {
+                                int rows = height - r0 < band ? height - r0
+                                                              : band;
+                                int x0 = orientation == A2_ROTATE_90
+                                       ? height - r0 - rows : r0;
+                                memcpy(out + (size_t) x0 * size,
+                                       buffer + ((size_t) tileRows * x0 +
+                                                 (size_t) r * rows) * size,
+                                       (size_t) rows * size);
+                        }
+                        w.used += dstStride;
+                }
+        }
+        writerClose(&w);
+        close(fd);
+        alloc->free(alloc, buffer, band * longest);
+}
+
+#undef T
@@ -0,0 +1,67 @@
+/**************************************************************
+ *
+ *                     ppmio.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for fast binary (P6) PPM input and output. A
+ *              file is mapped into memory instead of read through stdio,
+ *              and its raster is converted straight into the pixel layout
+ *              and A2 backend the caller asks for, or used in place with no
+ *              copy when the caller asks for the raster's own layout. Output
+ *              is formatted into large buffers a band of rows at a time and
+ *              handed to the kernel with writev.
+ *
+ **************************************************************/
+
+#ifndef PPMIO_INCLUDED
+#define PPMIO_INCLUDED
+
+#include <stdio.h>
+#include "a2methods.h"
+#include "pnm.h"
+
+#define T Ppmio_T
+typedef struct T *T;
+
+/* maps a P6 image; NULL if fp is not a regular file holding a valid P6
+ * image, in which case nothing has been read from fp */
+extern T        Ppmio_open (FILE *fp);
+extern void     Ppmio_close(T *input);
+
+extern unsigned Ppmio_width      (T input);
+extern unsigned Ppmio_height     (T input);
+extern unsigned Ppmio_denominator(T input);
+
+/* the image with pixels of size bytes: 3 or 6 (the raster layout, a view of
+ * the mapped file for plain methods), 4 or 8 (packed, see a2pack.h) or 12
+ * (struct Pnm_rgb); free it with Pnm_ppmfree before closing input */
+extern Pnm_ppm  Ppmio_read(T input, A2Methods_T methods, int size);
+
+/* the image already transformed by an A2_* orientation, without making the
+ * untransformed image; the pixels are always a copy */
+extern Pnm_ppm  Ppmio_read_transformed(T input, A2Methods_T methods,
+                                       int size, int orientation);
+
+/* writes image as a P6 PPM; its pixels may have any of the sizes
+ * Ppmio_read makes, in any A2 backend */
+extern void     Ppmio_write(FILE *fp, Pnm_ppm image);
+
+/* writes image transformed by an A2_* orientation, without making the
+ * transformed image */
+extern void     Ppmio_write_transformed(FILE *fp, Pnm_ppm image,
+                                        int orientation);
+
+/* writes input flipped, rotated by 180 or unchanged straight from the
+ * mapping, one row at a time, without making any array */
+extern void     Ppmio_stream(FILE *fp, T input, int orientation);
+
+/* writes input rotated by 90 or 270 or transposed using about budget bytes
+ * of memory, spilling tiles to a temporary file in $TMPDIR (or /var/tmp) */
+extern void     Ppmio_transform_out_of_core(FILE *fp, T input,
+                                            int orientation, size_t budget);
+
+#undef T
+#endif
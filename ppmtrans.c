@@ -23,26 +23,29 @@
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2rect.h"
+#include "a2transform.h"
+#include "a2kernels.h"
+#include "a2pack.h"
+#include "a2planar.h"
+#include "a2compressed.h"
+#include "uarray2bz.h"
+#include "ppmio.h"
+#include "uarray2b.h"
 #include "pnm.h"
 #include "cputiming.h"
 
 typedef A2Methods_UArray2 A2;
 
 
-struct mappingCl {
-        A2 newMap;
-        A2Methods_T methods;
-
-};
-
 /* Definition of transformation options used by main and transform */
-#define ZERO 0
-#define NINETY 90
-#define ONE_EIGHTY 180
-#define TWO_SEVENTY 270
-#define HORIZONTAL 1
-#define VERTICAL 2
-#define TRANSPOSE 3
+#define ZERO            A2_ROTATE_0
+#define NINETY          A2_ROTATE_90
+#define ONE_EIGHTY      A2_ROTATE_180
+#define TWO_SEVENTY     A2_ROTATE_270
+#define HORIZONTAL      A2_FLIP_HORIZONTAL
+#define VERTICAL        A2_FLIP_VERTICAL
+#define TRANSPOSE       A2_TRANSPOSE
 
 #define SET_METHODS(METHODS, MAP, WHAT) do {                    \
         methods = (METHODS);                                    \
@@ -81,330 +84,63 @@ usage(const char *progname)
 {
         fprintf(stderr, "Usage: %s ([-rotate <angle>] OR [-transpose] OR "
                         "[-flip <vertical,horizontal>]) "
-                        "[-{row,col,block}-major] "
+                        "[-{row,col,block}-major | -block-shape WxH[/WxH] | "
+                        "-compressed] "
+                        "[-compressed-info] "
+                        "[-{src,dest}-major | -tiled | -fused | "
+                        "-fused-read] [-no-stream] "
+                        "[-prefetch distance] [-block-pad lines] "
+                        "[-stream-threshold bytes] "
+                        "[-max-mem bytes[K|M|G]] [-blocks-out] "
+                        "[-isa scalar|sse4.2|avx2|avx512] [-isa-info] "
+                        "[-no-pack | -raw | -planar] "
                         "[-time time_file] "
                         "[filename]\n",
                         progname);
         exit(1);
 }
 
-/********** apply90 ********
- *
- * Rotates an image represented by a UArray2 structure by 90 degrees.
- *
- * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
- *
- * Return: 
- *      N/A
- *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
- *
- ************************/
-void apply90(int i, int j, A2 array2, void *elem, void *cl)
-{
-        assert(cl != NULL);
-        assert(array2 != NULL);
-
-        
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-
-        /* Rotate image 90 degrees clockwise. */
-        struct Pnm_rgb *rgb = elem;
-        int height = methods->height(array2);
-        *(struct Pnm_rgb *)methods->at(newMap, height - j - 1, i) 
-                                                      = *(struct Pnm_rgb *)rgb;
-}
-
-/********** apply180 ********
- *
- * Rotates an image represented by a UArray2 structure by 180 degrees.
- *
- * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
- *
- * Return: 
- *      N/A
- *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
- *
- ************************/
-void apply180(int i, int j, A2 array2, void *elem, void *cl)
-{
-        assert(cl != NULL);
-        assert(array2 != NULL);
-
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-
-        /* Rotate image 180 degrees. */
-        struct Pnm_rgb *rgb = elem;
-        int width = methods->width(array2);
-        int height = methods->height(array2);
-        *(struct Pnm_rgb *)methods->at(newMap, width - i - 1, height - j - 1)
-                                                      = *(struct Pnm_rgb *)rgb;
-}
-
-/********** apply270 ********
- *
- * Rotates an image represented by a UArray2 structure by 270 degrees.
- *
- * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
- *
- * Return: 
- *      N/A
- *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
- *
- ************************/
-void apply270(int i, int j, A2 array2, void *elem, void *cl)
-{
-        assert(cl != NULL);
-        assert(array2 != NULL);
-
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-        
-        /* Rotate image 270 degrees clockwise (or 90 ccw). */
-        int width = methods->width(array2);
-        struct Pnm_rgb *rgb = elem;
-        *(struct Pnm_rgb *)methods->at(newMap, j, width - i - 1)
-                                                      = *(struct Pnm_rgb *)rgb;
-}
-
-/********** applyTranspose ********
- *
- * Transposes and image represented by a UArray2 structure.
- *
- * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
- *
- * Return: 
- *      N/A
- *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
- *
- ************************/
-void applyTranspose(int i, int j, A2 array2, void *elem, void *cl)
-{
-        assert(cl != NULL);
-        assert(array2 != NULL);
-        assert(elem != NULL);
-
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-        
-        /* Transpose image (across UL-to-LR axis). */
-        struct Pnm_rgb *rgb = elem;
-        *(struct Pnm_rgb *)methods->at(newMap, j, i) = *(struct Pnm_rgb *)rgb;
-}
-
-/********** applyHorizontal ********
- *
- * Flips an image represented by a UArray2 structure horizontally.
- *
- * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
- *
- * Return: 
- *      N/A
- *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
- *
- ************************/
-void applyHorizontal(int i, int j, A2 array2, void *elem, void *cl)
-{
-        assert(cl != NULL);
-        assert(array2 != NULL);
-
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-
-        /* Mirror image horizontally (lef-right). */
-        struct Pnm_rgb *rgb = elem;
-        int height = methods->height(array2);
-        *(struct Pnm_rgb *)methods->at(newMap, i, height - j - 1)
-                                                      = *(struct Pnm_rgb *)rgb;
-}
+/* the write time of transforms that write as they go */
+#define WRITE_INCLUDED -1.0
 
-/********** applyVertical ********
+/********** reportTime ********
  *
- * Flips an image represented by a UArray2 structure horizontally.
+ * Writes the time a transformation took to a file, if one was asked for
  *
  * Parameters:
- *      int     i:              The current row in the original image.
- *      int     j:              The current column in the original image.
- *      A2      array2:         The UArray2 representing the original 
- *                              image.
- *      void    *elem:          A pointer to the current pixel's RGB value.
- *      void    *cl:            A pointer to a structure containing necessary 
- *                              context (e.g., methods and newMap).
+ *      const char *time_file_name:     the file, or NULL for none
+ *      double cputime:                 nanoseconds spent transforming
+ *      double writetime:               nanoseconds spent writing the
+ *                                      output, or WRITE_INCLUDED if it was
+ *                                      written during the transform
+ *      int width, height:              the dimensions of the image
  *
- * Return: 
- *      N/A
+ * Return: n/a
  *
- * Preconditions:
- *      - array2 must not be NULL.
- *      - cl must not be NULL.
- *      - elem must not be NULL.
- *      - The contents of the cl struct must not be NULL.
- *      - i must be a non-negative integer within the width of array2.
- *      - j must be a non-negative integer within the height of array2.
- *
- * Notes: 
- *      - Calls a CRE if any of the above preconditions are 
- *        violated.
- *      - Assumes the memory for newMap has been allocated and initialized 
- *        correctly before this function is called.
- *      - The user is responsible for calling UArray2b_free to free any 
- *        allocated memory associated with the UArray2 structure.
+ * Notes:
+ *      - Calls CRE if the file cannot be opened
+ *      - The total is the transform alone unless the write time says
+ *      writing is included
  *
  ************************/
-void applyVertical(int i, int j, A2 array2, void *elem, void *cl)
+static void reportTime(const char *time_file_name, double cputime,
+                       double writetime, int width, int height)
 {
-        assert(cl != NULL);
-        assert(array2 != NULL);
-
-        struct mappingCl *bundle = cl;
-        A2Methods_T methods = bundle->methods;
-        A2 newMap = bundle->newMap;
-        assert(methods != NULL);
-        assert(newMap != NULL);
-        assert(i >= 0 && i < methods->width(array2));
-        assert(j >= 0 && j < methods->height(array2));
-
-        /* Mirror image vertically (top-bottom). */
-        struct Pnm_rgb *rgb = elem;
-        int width = methods->width(array2);
-        *(struct Pnm_rgb *)methods->at(newMap, width - i - 1, j)
-                                                      = *(struct Pnm_rgb *)rgb;
+        /* Only writes the time data to a file if the -time flag was used. */
+        if (time_file_name == NULL) {
+                return;
+        }
+        double pixelTime = cputime / ((double) width * height);
+        FILE *fp = fopen(time_file_name, "w");
+        assert(fp != NULL);
+        fprintf(fp, "Total time: %.0f\nTime Per Pixel: %.0f\n", cputime,
+                                                                pixelTime);
+        if (writetime == WRITE_INCLUDED) {
+                fprintf(fp, "Write time: included\n");
+        } else {
+                fprintf(fp, "Write time: %.0f\n", writetime);
+        }
+        fclose(fp);
 }
 
 /********** transform ********
@@ -424,6 +160,13 @@ void applyVertical(int i, int j, A2 array2, void *elem, void *cl)
  *                                              transformations.
  *      A2Methods_T             methods:        A structure containing methods 
  *                                              for manipulating the UArray2.
+ *      int                     direction:      A2_SCATTER to traverse the
+ *                                              source, A2_GATHER to traverse
+ *                                              the destination, A2_TILED to
+ *                                              go tile by tile, or -1 to let
+ *                                              A2_plan_direction choose.
+ *      int                     prefetch:       How many blocks or tiles ahead
+ *                                              to prefetch, 0 for none.
  *
  * Return: 
  *      Pnm_ppm: A pointer to the transformed Pnm_ppm structure.
@@ -445,7 +188,7 @@ void applyVertical(int i, int j, A2 array2, void *elem, void *cl)
  *
  ************************/
 Pnm_ppm transform(Pnm_ppm ppmMap, int transformation, A2Methods_mapfun *map, 
-                                                           A2Methods_T methods)
+                     A2Methods_T methods, int direction, int prefetch)
 {
         assert(methods != NULL);
         assert(map != NULL);
@@ -459,35 +202,29 @@ Pnm_ppm transform(Pnm_ppm ppmMap, int transformation, A2Methods_mapfun *map,
         if (transformation == ZERO) {
                 return ppmMap;
         }
-        int newHeight = methods->height(ppmMap->pixels);
-        int newWidth = methods->width(ppmMap->pixels);
-        /* 
-         * Changes the dimensions of the destination array if required based on
-         * the type of transformation. 
-         */
-        if (transformation == NINETY || 
-            transformation == TWO_SEVENTY || 
-            transformation == TRANSPOSE) {
-                newHeight = methods->width(ppmMap->pixels);
-                newWidth = methods->height(ppmMap->pixels);
-        }
+        int width = methods->width(ppmMap->pixels);
+        int height = methods->height(ppmMap->pixels);
+        int newWidth = A2_transform_width(transformation, width, height);
+        int newHeight = A2_transform_height(transformation, width, height);
         
-        A2 newMap = methods->new(newWidth, newHeight, sizeof(struct Pnm_rgb));
-        struct mappingCl bundle = {newMap, methods};
-
-        /* These if statements determine which apply function will be used. */
-        if (transformation == NINETY) {
-                map(ppmMap->pixels, apply90, &bundle);
-        } else if (transformation == ONE_EIGHTY) {
-                map(ppmMap->pixels, apply180, &bundle);
-        } else if (transformation == TWO_SEVENTY) {
-                map(ppmMap->pixels, apply270, &bundle);
-        } else if (transformation == TRANSPOSE) {
-                map(ppmMap->pixels, applyTranspose, &bundle);
-        } else if (transformation == HORIZONTAL) {
-                map(ppmMap->pixels, applyHorizontal, &bundle);
-        } else if (transformation == VERTICAL) {
-                map(ppmMap->pixels, applyVertical, &bundle);
+        A2 newMap = methods->new(newWidth, newHeight,
+                                 methods->size(ppmMap->pixels));
+        if (A2_is_blocked(methods)) {
+                UArray2b_set_prefetch(ppmMap->pixels, prefetch);
+                UArray2b_set_prefetch(newMap, prefetch);
+        }
+        if (direction < 0) {
+                direction = A2_plan_direction(methods, map, transformation);
+        }
+        if (direction == A2_GATHER) {
+                A2_transform_gather(methods, map, ppmMap->pixels, newMap,
+                                                               transformation);
+        } else if (direction == A2_TILED) {
+                A2_transform_tiled(methods, ppmMap->pixels, newMap,
+                                                     transformation, prefetch);
+        } else {
+                A2_transform(methods, map, ppmMap->pixels, newMap,
+                                                               transformation);
         }
         
         methods->free(&(ppmMap->pixels));
@@ -497,6 +234,60 @@ Pnm_ppm transform(Pnm_ppm ppmMap, int transformation, A2Methods_mapfun *map,
         return ppmMap;
 }
 
+/********** transformPlanar ********
+ *
+ *      Applies a transformation to an image held as three planes instead of
+ *      in ppmMap's pixel array, one plane at a time.
+ *
+ * Parameters:
+ *      Pnm_ppm                 ppmMap:         The image whose width and
+ *                                              height are updated; its
+ *                                              pixels are not used.
+ *      A2Planar_T              *planes:        The planes of the image,
+ *                                              replaced by the transformed
+ *                                              planes.
+ *      int                     transformation: The type of transformation to
+ *                                              apply.
+ *      A2Methods_mapfun        *map:           The mapping function for
+ *                                              scattering or gathering.
+ *      A2Methods_T             methods:        The methods of the planes.
+ *      int                     direction:      The same as for transform.
+ *
+ * Return:
+ *      Pnm_ppm: ppmMap, with the transformed width and height.
+ *
+ * Preconditions:
+ *      - ppmMap, planes, *planes, map and methods must not be NULL.
+ *
+ ************************/
+Pnm_ppm transformPlanar(Pnm_ppm ppmMap, A2Planar_T *planes, int transformation,
+                        A2Methods_mapfun *map, A2Methods_T methods,
+                        int direction)
+{
+        assert(ppmMap != NULL);
+        assert(planes != NULL && *planes != NULL);
+        assert(map != NULL);
+        assert(methods != NULL);
+
+        if (transformation == ZERO) {
+                return ppmMap;
+        }
+        int width = A2Planar_width(*planes);
+        int height = A2Planar_height(*planes);
+        int newWidth = A2_transform_width(transformation, width, height);
+        int newHeight = A2_transform_height(transformation, width, height);
+
+        A2Planar_T turned = A2Planar_new(methods, newWidth, newHeight,
+                                         A2Planar_depth(*planes));
+        A2Planar_transform(*planes, turned, map, transformation, direction);
+
+        A2Planar_free(planes);
+        *planes = turned;
+        ppmMap->width = newWidth;
+        ppmMap->height = newHeight;
+        return ppmMap;
+}
+
 /********** main ********
  *
  *      main manages the inputs and outputs of the ppmtrans program, parsing
@@ -528,6 +319,21 @@ int main(int argc, char *argv[])
         char *out_file_name = NULL;
 
         int   transformation       = 0;
+        int   direction            = -1;    /* planner chooses by default */
+        int   prefetch             = 0;     /* no software prefetch */
+        bool  isa_info             = false; /* print the kernels chosen */
+        bool  pack                 = true;  /* transform packed pixels */
+        bool  planar               = false; /* transform R, G, B planes */
+        bool  raw                  = false; /* transform P6 raster pixels */
+        bool  fused                = false; /* transform while writing */
+        bool  fused_read           = false; /* transform while reading */
+        bool  stream               = true;  /* stream flips from the file */
+        bool  layout_chosen        = false; /* a layout or traversal was
+                                             * asked for, which streaming
+                                             * would ignore */
+        size_t max_mem             = 0;     /* no memory budget */
+        bool  blocks_out           = false; /* write a saved UArray2b */
+        bool  compressed_info      = false; /* print compression stats */
         int   i;
 
         /* default to UArray2 methods */
@@ -540,14 +346,135 @@ int main(int argc, char *argv[])
 
         for (i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-row-major") == 0) {
+                        layout_chosen = true;
                         SET_METHODS(uarray2_methods_plain, map_row_major, 
                                     "row-major");
                 } else if (strcmp(argv[i], "-col-major") == 0) {
+                        layout_chosen = true;
                         SET_METHODS(uarray2_methods_plain, map_col_major, 
                                     "column-major");
                 } else if (strcmp(argv[i], "-block-major") == 0) {
+                        layout_chosen = true;
                         SET_METHODS(uarray2_methods_blocked, map_block_major,
                                     "block-major");
+                } else if (strcmp(argv[i], "-block-shape") == 0) {
+                        if (!(i + 1 < argc)) {      /* no shape */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long bw = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != 'x' || bw <= 0 || bw > 46340) {
+                                usage(argv[0]);
+                        }
+                        long bh = strtol(endptr + 1, &endptr, 10);
+                        if ((*endptr != '\0' && *endptr != '/') ||
+                            bh <= 0 || bh > 46340) {
+                                usage(argv[0]);
+                        }
+                        A2_set_block_shape(bw, bh);
+                        layout_chosen = true;
+                        if (*endptr == '/') {       /* tiles in the blocks */
+                                long tw = strtol(endptr + 1, &endptr, 10);
+                                if (*endptr != 'x' || tw <= 0 ||
+                                    bw % tw != 0) {
+                                        usage(argv[0]);
+                                }
+                                long th = strtol(endptr + 1, &endptr, 10);
+                                if (*endptr != '\0' || th <= 0 ||
+                                    bh % th != 0) {
+                                        usage(argv[0]);
+                                }
+                                A2_set_tile_shape(tw, th);
+                        }
+                        SET_METHODS(uarray2_methods_blocked_rect,
+                                    map_block_major, "block-major");
+                } else if (strcmp(argv[i], "-compressed") == 0) {
+                        layout_chosen = true;
+                        SET_METHODS(uarray2_methods_compressed,
+                                    map_block_major, "block-major");
+                } else if (strcmp(argv[i], "-compressed-info") == 0) {
+                        compressed_info = true;
+                } else if (strcmp(argv[i], "-src-major") == 0) {
+                        layout_chosen = true;
+                        direction = A2_SCATTER;
+                } else if (strcmp(argv[i], "-dest-major") == 0) {
+                        layout_chosen = true;
+                        direction = A2_GATHER;
+                } else if (strcmp(argv[i], "-tiled") == 0) {
+                        layout_chosen = true;
+                        direction = A2_TILED;
+                } else if (strcmp(argv[i], "-prefetch") == 0) {
+                        if (!(i + 1 < argc)) {      /* no distance */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        prefetch = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || prefetch < 0) {
+                                usage(argv[0]);
+                        }
+                        layout_chosen = true;
+                } else if (strcmp(argv[i], "-block-pad") == 0) {
+                        if (!(i + 1 < argc)) {      /* no padding */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long lines = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || lines < 0 || lines > 63) {
+                                usage(argv[0]);
+                        }
+                        UArray2b_set_default_padding(lines);
+                        layout_chosen = true;
+                } else if (strcmp(argv[i], "-stream-threshold") == 0) {
+                        if (!(i + 1 < argc)) {      /* no threshold */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long long bytes = strtoll(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || bytes < 0) {
+                                usage(argv[0]);
+                        }
+                        A2_set_stream_threshold(bytes);
+                } else if (strcmp(argv[i], "-isa") == 0) {
+                        if (!(i + 1 < argc)) {      /* no instruction set */
+                                usage(argv[0]);
+                        }
+                        if (!A2Kernel_select(argv[++i])) {
+                                fprintf(stderr, "%s: instruction set '%s' is "
+                                        "unknown or not supported here\n",
+                                        argv[0], argv[i]);
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-isa-info") == 0) {
+                        isa_info = true;
+                } else if (strcmp(argv[i], "-no-pack") == 0) {
+                        pack = false;
+                } else if (strcmp(argv[i], "-planar") == 0) {
+                        planar = true;
+                } else if (strcmp(argv[i], "-raw") == 0) {
+                        raw = true;
+                } else if (strcmp(argv[i], "-fused") == 0) {
+                        fused = true;
+                } else if (strcmp(argv[i], "-fused-read") == 0) {
+                        fused_read = true;
+                } else if (strcmp(argv[i], "-no-stream") == 0) {
+                        stream = false;
+                } else if (strcmp(argv[i], "-blocks-out") == 0) {
+                        blocks_out = true;
+                } else if (strcmp(argv[i], "-max-mem") == 0) {
+                        if (!(i + 1 < argc)) {      /* no budget */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long long bytes = strtoll(argv[++i], &endptr, 10);
+                        int shift = *endptr == 'K' ? 10 : *endptr == 'M' ? 20
+                                  : *endptr == 'G' ? 30 : 0;
+                        if (shift > 0) {
+                                endptr++;
+                        }
+                        if (*endptr != '\0' || bytes <= 0) {
+                                usage(argv[0]);
+                        }
+                        max_mem = (size_t) bytes << shift;
                 } else if (strcmp(argv[i], "-rotate") == 0) {
                         if (!(i + 1 < argc)) {      /* no rotate value */
                                 usage(argv[0]);
@@ -600,6 +527,19 @@ int main(int argc, char *argv[])
                 }
         }
 
+        if (isa_info) {
+                A2Kernel_print(stderr);
+        }
+        if (blocks_out) {
+                /* only a UArray2b can be saved, and it is not written as it
+                 * is gathered */
+                if (!A2_is_blocked(methods)) {
+                        SET_METHODS(uarray2_methods_blocked, map_block_major,
+                                    "block-major");
+                }
+                fused = false;
+        }
+
         FILE *fp;
         if (out_file_name == NULL) {
                 fp = stdin;
@@ -608,36 +548,186 @@ int main(int argc, char *argv[])
                 assert(fp != NULL);
         }
 
-        Pnm_ppm ppmMap = Pnm_ppmread(fp, methods);
+        /*
+         * transform 4 or 8 byte packed pixels by default, the raster's own 3
+         * or 6 byte pixels with -raw, or 12 byte Pnm_rgb structs with
+         * -no-pack and -planar. Mapped P6 files are converted while they are
+         * read and files saved with -blocks-out are mapped as they are;
+         * anything else goes through Pnm_ppmread and is converted
+         * afterwards. Either way this is outside the timed region.
+         */
+        CPUTime_T timer = CPUTime_New();
+        double cputime = 0;
+        Ppmio_T input = Ppmio_open(fp);
+        unsigned tag = 0;
+        UArray2b_T saved = input == NULL ? UArray2b_load(fp, &tag) : NULL;
+        if (saved != NULL) {
+                /* a saved image is mapped as the UArray2b it was */
+                SET_METHODS(uarray2_methods_blocked, map_block_major,
+                            "block-major");
+        }
+        bool rowsStay = transformation == ZERO ||
+                        transformation == ONE_EIGHTY ||
+                        transformation == HORIZONTAL ||
+                        transformation == VERTICAL;
+        bool overBudget = false;
+        if (input != NULL && max_mem > 0) {
+                /* an in-memory transform holds a source and a destination */
+                unsigned denominator = Ppmio_denominator(input);
+                size_t size = sizeof(struct Pnm_rgb);
+                if (raw && !planar) {
+                        size = denominator <= 255 ? 3 : 6;
+                } else if (pack && !planar) {
+                        size = A2_packed_size(denominator);
+                }
+                overBudget = 2 * size * Ppmio_width(input) *
+                             Ppmio_height(input) > max_mem;
+        }
+        if (input != NULL && !blocks_out &&
+            (overBudget || (stream && !layout_chosen && rowsStay &&
+                            !planar && !fused && !fused_read))) {
+                /*
+                 * rows that stay rows are copied, or reversed, from the
+                 * mapping straight to stdout in the order they are needed;
+                 * rotations that do not fit the budget go through tiles in
+                 * a temporary file. No image is ever made, so transforming
+                 * and writing are one pass and are timed together; only
+                 * done by default when no layout or traversal is asked for
+                 */
+                fclose(fp);
+                CPUTime_Start(timer);
+                if (rowsStay) {
+                        Ppmio_stream(stdout, input, transformation);
+                } else {
+                        Ppmio_transform_out_of_core(stdout, input,
+                                                    transformation, max_mem);
+                }
+                cputime = CPUTime_Stop(timer);
+                CPUTime_Free(&timer);
+                reportTime(time_file_name, cputime, WRITE_INCLUDED,
+                           Ppmio_width(input), Ppmio_height(input));
+                Ppmio_close(&input);
+                return EXIT_SUCCESS;
+        }
+        Pnm_ppm ppmMap;
+        if (saved != NULL) {
+                /* the pixels keep the size they were saved with */
+                ppmMap = malloc(sizeof(*ppmMap));
+                assert(ppmMap != NULL);
+                ppmMap->width = UArray2b_width(saved);
+                ppmMap->height = UArray2b_height(saved);
+                ppmMap->denominator = tag;
+                ppmMap->pixels = saved;
+                ppmMap->methods = methods;
+                if (planar && UArray2b_size(saved) != sizeof(struct Pnm_rgb)) {
+                        ppmMap->pixels = A2_unpack(methods, saved);
+                        UArray2b_free(&saved);
+                }
+        } else if (input != NULL && fused_read && !planar) {
+                /*
+                 * pixels are parsed straight into their transformed places,
+                 * so the read is the timed region and nothing is left to
+                 * transform
+                 */
+                unsigned denominator = Ppmio_denominator(input);
+                int size = raw ? (denominator <= 255 ? 3 : 6)
+                         : pack ? A2_packed_size(denominator)
+                         : (int) sizeof(struct Pnm_rgb);
+                CPUTime_Start(timer);
+                ppmMap = Ppmio_read_transformed(input, methods, size,
+                                                              transformation);
+                cputime = CPUTime_Stop(timer);
+                transformation = ZERO;
+        } else if (input != NULL) {
+                unsigned denominator = Ppmio_denominator(input);
+                int size = sizeof(struct Pnm_rgb);
+                if (raw && !planar) {
+                        size = denominator <= 255 ? 3 : 6;
+                } else if (pack && !planar) {
+                        size = A2_packed_size(denominator);
+                }
+                ppmMap = Ppmio_read(input, methods, size);
+        } else {
+                /* pipes are read whole as Pnm_rgb pixels, then narrowed
+                 * to what the file path would have read */
+                ppmMap = Pnm_ppmread(fp, methods);
+                if ((pack || raw) && !planar) {
+                        int size = A2_packed_size(ppmMap->denominator);
+                        if (raw) {
+                                size = ppmMap->denominator <= 255 ? 3 : 6;
+                        }
+                        A2 packed = A2_pack(methods, ppmMap->pixels, size);
+                        methods->free(&(ppmMap->pixels));
+                        ppmMap->pixels = packed;
+                }
+        }
         fclose(fp);
 
+        A2Planar_T planes = NULL;
+        if (planar) {
+                planes = A2Planar_from_rgb(methods, ppmMap->pixels,
+                                           ppmMap->denominator);
+                methods->free(&(ppmMap->pixels));
+        }
+
+        compressed_info = compressed_info && !planar &&
+                          methods == uarray2_methods_compressed;
+        if (compressed_info) {
+                fprintf(stderr, "source\n");
+                UArray2bz_print(ppmMap->pixels, stderr);
+        }
+
         /* 
          * start timer after ppmMap is made and the image is read and before 
          * transforming happens 
          */
-        CPUTime_T timer = CPUTime_New();
         CPUTime_Start(timer);
-        Pnm_ppm transformed = transform(ppmMap, transformation, map, methods);
-        double cputime = CPUTime_Stop(timer);
+        Pnm_ppm transformed = ppmMap;
+        if (planar) {
+                transformed = transformPlanar(ppmMap, &planes, transformation,
+                                                  map, methods, direction);
+        } else if (fused) {
+                /* no destination: the output is gathered as it is written,
+                 * so the timed region includes writing */
+                Ppmio_write_transformed(stdout, ppmMap, transformation);
+        } else {
+                transformed = transform(ppmMap, transformation, map, methods,
+                                                          direction, prefetch);
+        }
+        cputime += CPUTime_Stop(timer);
         /* 
          * stop timer after transformation and before writing the 
          * transformed ppm to stdout 
          */
-        Pnm_ppmwrite(stdout, transformed);
-        double pixelTime = cputime / (ppmMap->width * ppmMap->height);
-        CPUTime_Free(&timer);
-        
-        /* Only writes the time data to a file if the -time flag was used. */
-        if (time_file_name != NULL) {
-                fp = fopen(time_file_name, "w");
-                assert(fp != NULL);
-                fprintf(fp, "Total time: %.0f\nTime Per Pixel: %.0f\n", 
-                                                                cputime,
-                                                                pixelTime);
-                fclose(fp);
+        if (planar) {
+                transformed->pixels = A2Planar_to_rgb(planes);
+                A2Planar_free(&planes);
+        }
+        /* writing is timed on its own */
+        double writetime = WRITE_INCLUDED;
+        if (blocks_out) {
+                CPUTime_Start(timer);
+                UArray2b_save(transformed->pixels, stdout,
+                              transformed->denominator);
+                writetime = CPUTime_Stop(timer);
+        } else if (planar || !fused) {
+                CPUTime_Start(timer);
+                Ppmio_write(stdout, transformed);
+                writetime = CPUTime_Stop(timer);
         }
+        if (compressed_info) {
+                fprintf(stderr, "%s\n", fused ? "source after writing"
+                                                : "result after writing");
+                UArray2bz_print(transformed->pixels, stderr);
+        }
+        CPUTime_Free(&timer);
+        reportTime(time_file_name, cputime, writetime, ppmMap->width,
+                   ppmMap->height);
 
         Pnm_ppmfree(&ppmMap);
+        if (input != NULL) {
+                Ppmio_close(&input);
+        }
 
         return EXIT_SUCCESS;
 
@@ -2,14 +2,46 @@
 
 # loop thorugh the directory
 # only access files that end in .jpg
-# then run the command, and have the test file have the same name as the 
+# then run the command, and have the test file have the same name as the
 # picture used, plus the translation done
+#
+# every transformation is timed for each mapping method, once traversing the
+# source (-src-major) and once traversing the destination (-dest-major);
+# block-major and tiled runs are repeated with software prefetching on, and
+# blocks of several sizes are timed with and without padding between them,
+# and blocks of one size in several shapes (the README's shape table)
 
 echo "RUNNING TESTS"
 
 directory="$1"
 
-for file in "$directory"/*; 
+# run_transforms file method options
+# appends the timing of every transformation to the file's .out file
+run_transforms()
+{
+        local file="$1"
+        local method="$2"
+        local options="$3"
+        local out
+        out=$(basename "$file").out
+
+        for transform in "" "-rotate 90" "-rotate 270" "-rotate 180" \
+                         "-flip horizontal" "-flip vertical" "-transpose"
+        do
+                eval "djpeg ${file} | ./ppmtrans ${transform} ${method} ${options} -time timeBash.out > bashTest.out"
+                if [ -z "$transform" ]
+                then
+                        echo "rotate 0 ${method} ${options}" >> "$out"
+                else
+                        echo "${transform#-} ${method} ${options}" >> "$out"
+                fi
+                eval "cat timeBash.out >> ${out}"
+                echo "" >> "$out"
+        done
+        echo "" >> "$out"
+}
+
+for file in "$directory"/*;
 do
         extension=$(echo "$file" | awk -F. '{print $NF}')
         if [ "$extension" == "jpg" ]
@@ -20,125 +52,40 @@ do
 
                 echo "$file"
 
-                method="-row-major"
-
                 echo "### ROW MAJOR ###" >> $(basename "$file").out
-                eval "djpeg ${file} | ./ppmtrans ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 0 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 90 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 90 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 270 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 270 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 180 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 180 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip horizontal ${method} -time timeBash.out > bashTest.out"
-                echo "horizontal ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip vertical ${method} -time timeBash.out > bashTest.out"
-                echo "vertical ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -transpose ${method} -time timeBash.out > bashTest.out"
-                echo "transpose ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-                echo "" >> $(basename "$file").out
-
-                
-                
-                echo "COL MAJOR" >> $(basename "$file").out 
-                method="-col-major"
-
-                eval "djpeg ${file} | ./ppmtrans ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 0 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 90 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 90 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 270 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 270 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 180 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 180 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip horizontal ${method} -time timeBash.out > bashTest.out"
-                echo "horizontal ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip vertical ${method} -time timeBash.out > bashTest.out"
-                echo "vertical ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -transpose ${method} -time timeBash.out > bashTest.out"
-                echo "transpose ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-                echo "" >> $(basename "$file").out
-
-                echo "BLOCK MAJOR" >> $(basename "$file").out 
-                method="-block-major"
-
-                eval "djpeg ${file} | ./ppmtrans ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 0 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 90 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 90 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 270 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 270 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -rotate 180 ${method} -time timeBash.out > bashTest.out"
-                echo "rotate 180 ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip horizontal ${method} -time timeBash.out > bashTest.out"
-                echo "horizontal ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -flip vertical ${method} -time timeBash.out > bashTest.out"
-                echo "vertical ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-
-                eval "djpeg ${file} | ./ppmtrans -transpose ${method} -time timeBash.out > bashTest.out"
-                echo "transpose ${method}" >> $(basename "$file").out
-                eval "cat timeBash.out >> $(basename "$file").out"
-                echo "" >> $(basename "$file").out
-                echo "" >> $(basename "$file").out
+                run_transforms "$file" "-row-major" "-src-major"
+                run_transforms "$file" "-row-major" "-dest-major"
+
+                echo "COL MAJOR" >> $(basename "$file").out
+                run_transforms "$file" "-col-major" "-src-major"
+                run_transforms "$file" "-col-major" "-dest-major"
+
+                echo "BLOCK MAJOR" >> $(basename "$file").out
+                run_transforms "$file" "-block-major" "-src-major"
+                run_transforms "$file" "-block-major" "-dest-major"
+                run_transforms "$file" "-block-major" "-src-major -prefetch 2"
+                run_transforms "$file" "-block-major" "-dest-major -prefetch 2"
+
+                echo "PADDED BLOCKS" >> $(basename "$file").out
+                for shape in 64x64 128x128 256x256 512x512
+                do
+                        run_transforms "$file" "-block-shape $shape" \
+                                       "-dest-major"
+                        run_transforms "$file" "-block-shape $shape" \
+                                       "-dest-major -block-pad 1"
+                done
+
+                echo "BLOCK SHAPES" >> $(basename "$file").out
+                for shape in 64x64 128x32 256x16 512x8 32x128 16x256
+                do
+                        run_transforms "$file" "-block-shape $shape" \
+                                       "-no-stream"
+                done
+
+                echo "TILED" >> $(basename "$file").out
+                run_transforms "$file" "-row-major" "-tiled"
+                run_transforms "$file" "-row-major" "-tiled -prefetch 4"
         fi
 done
 
-echo "TESTS DONE"
\ No newline at end of file
+echo "TESTS DONE"
@@ -7,12 +7,19 @@
  *     Date:    2-10-25
  *
  *     Summary: The implementation for a 2D version of Hanson's UArray data 
- *              structure and its relevent functions. It is built upon a single
- *              UArray that stores the data for a 2D implementation.
+ *              structure and its relevent functions. The elements are stored
+ *              row by row in one allocation, like a single UArray, but are
+ *              indexed with 64-bit offsets, as a UArray's int length cannot
+ *              count the elements of images past 2^31 pixels.
  *
  **************************************************************/
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "uarray2.h"
+#include "a2alloc.h"
 
 #define T UArray2_T
 
@@ -21,7 +28,11 @@ struct T {
         int height;
         int size;
 
-        UArray_T array;
+        char *elems;    /* width * height elements stored row by row */
+        size_t stride;  /* bytes per row, width * size */
+        bool view;      /* true if the elements belong to someone else */
+        A2Alloc_T alloc;        /* the allocator the elements came from, or
+                                 * NULL if calloc made them */
 };
 
 /********** UArrary2_new ********
@@ -43,9 +54,12 @@ struct T {
  * Notes: 
  *      - Calls a CRE when width and height are less than 0
  *      - Calls a CRE when size is less than 1
- *      - Calls a CRE if fails to allocate memory for the UArray2
- *      - Allocates memory for the UArray2 pointer and the subsequent UArray it
- *      holds. User is responsible for calling UArray2_free to free this memory.
+ *      - Calls a CRE if fails to allocate memory for the UArray2, or if its
+ *      bytes do not fit in a size_t
+ *      - Allocates memory for the UArray2 pointer and the elements it holds.
+ *      User is responsible for calling UArray2_free to free this memory.
+ *      - The elements come from the calling thread's allocator (see
+ *      A2Alloc_use) and are zeroed whichever it is
  *      
  ************************/
 T UArray2_new(int width, int height, int size) 
@@ -59,10 +73,68 @@ T UArray2_new(int width, int height, int size)
         uarray2->width = width;
         uarray2->height = height;
         uarray2->size = size;
+        uarray2->stride = (size_t) width * size;
+
+        /* the number of elements is the width of 2d uarray times its
+        height, counted in 64 bits */
+        size_t count = (size_t) width * height;
+        assert(count <= SIZE_MAX / size);
+        A2Alloc_T alloc = A2Alloc_current();
+        uarray2->view = false;
+        uarray2->alloc = NULL;
+        if (alloc == A2Alloc_malloc) {
+                /* calloc leaves the pages of a huge array to be zeroed
+                 * by the kernel when first touched */
+                uarray2->elems = calloc(count > 0 ? count : 1, size);
+                assert(uarray2->elems != NULL);
+                return uarray2;
+        }
+
+        uarray2->elems = alloc->alloc(alloc, count * size);
+        memset(uarray2->elems, 0, count * size);
+        uarray2->alloc = alloc;
+
+        return uarray2;
+}
+
+/********** UArrary2_view ********
+ *
+ * Creates a 2D UArray over memory the caller already holds, such as an
+ * mmapped image raster, without copying it
+ *
+ * Parameters:
+ *      int     width:          the number of columns in the 2D UArray
+ *      int     height:         the number of rows in the 2D UArray
+ *      int     size:           the number of bytes in each element
+ *      void   *elems:          width * height elements stored row by row
+ *
+ * Return: A pointer to the UArray2 that was created and malloc'd
+ *
+ * Expects: width and height to be non-negative, size to be positive and
+ *          elems to not be NULL
+ *
+ * Notes:
+ *      - Calls a CRE when any of the expectations are violated or memory for
+ *      the UArray2 cannot be allocated
+ *      - UArray2_free frees the UArray2 but not elems, which must outlive it
+ *
+ ************************/
+T UArray2_view(int width, int height, int size, void *elems)
+{
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
+        assert(elems != NULL);
+
+        T uarray2 = malloc(sizeof(*uarray2));
+        assert(uarray2 != NULL);
 
-        /* the number of elements of the uarray representing the uarray2 is 
-        the width of 2d uarray times its height */
-        uarray2->array = UArray_new((width * height), size);
+        uarray2->width = width;
+        uarray2->height = height;
+        uarray2->size = size;
+        uarray2->stride = (size_t) width * size;
+        uarray2->elems = elems;
+        uarray2->view = true;
+        uarray2->alloc = NULL;
 
         return uarray2;
 }
@@ -82,7 +154,8 @@ T UArray2_new(int width, int height, int size)
  * Notes: 
  *      - Calls CRE when uarray2 or *uarray2 is null
  *      - Frees the memory associated with the UArray2 including its pointer and
- *      the UArray within it.
+ *      its elements. The elements of a view made by UArray2_view are left to
+ *      their owner, and elements from an allocator go back to it.
  *      
  ************************/
 void UArray2_free(T *uarray2) 
@@ -90,8 +163,15 @@ void UArray2_free(T *uarray2)
         assert(uarray2 != NULL);
         assert(*uarray2 != NULL);
 
-        UArray_free(&((*uarray2)->array));
-        free(*uarray2);
+        T array = *uarray2;
+        if (array->alloc != NULL) {
+                array->alloc->free(array->alloc, array->elems,
+                                   array->stride * array->height);
+        } else if (!array->view) {
+                free(array->elems);
+        }
+        free(array);
+        *uarray2 = NULL;
 }
 
 /********** UArrary2_width ********
@@ -191,9 +271,39 @@ void *UArray2_at(T uarray2, int column, int row)
         
         /* To get location of an element in the 2d uarray, get to the start
          * of the row you are looking for (by multiplying the inputted row by
-         * the width) then go forward to the column you want (adding the 
-         * inputted column to the row * width) */
-        return UArray_at(uarray2->array, (row) * (uarray2->width) + (column)); 
+         * the bytes in a row) then go forward to the column you want; the
+         * row offset is 64-bit, so arrays past 2^31 elements work */
+        return uarray2->elems + (size_t) row * uarray2->stride +
+               (size_t) column * uarray2->size;
+}
+
+/********** UArrary2_row ********
+ *
+ * Retrieves a pointer to the first element of a row in uarray2. The elements
+ * of a row are stored next to each other, so the element at column c of the
+ * row is c * UArray2_size(uarray2) bytes past the returned pointer.
+ *
+ * Parameters:
+ *      T       uarray2:        a pointer to the UArray2_T Struct representing
+ *                              the UArray2 being accessed
+ *      int     row:            the row in the 2D UArray being accessed
+ *
+ * Return: void * to the element at (0, row) in the 2D UArray
+ *
+ * Expects: row to be at least 0 and less than the height of uarray2, uarray2
+ *          to not be NULL and to have a width greater than 0
+ *
+ * Notes:
+ *      - Calls CRE when any of the expectations are violated
+ *
+ ************************/
+void *UArray2_row(T uarray2, int row)
+{
+        assert(uarray2 != NULL);
+        assert(row >= 0 && row < uarray2->height);
+        assert(uarray2->width > 0);
+
+        return uarray2->elems + (size_t) row * uarray2->stride;
 }
 
 /********** UArrary2_map_col_major ********
@@ -286,8 +396,10 @@ void UArray2_map_row_major(T uarray2, void (*apply)(int column, int row,
          * the array then go to the next row, repeat this until you've mapped 
          * the whole array */
         for (int i = 0; i < uarray2->height; i++) {
+                char *elem = uarray2->elems + (size_t) i * uarray2->stride;
                 for (int j = 0; j < uarray2->width; j++) {
-                        apply(j, i, uarray2, UArray2_at(uarray2, j, i), cl);
+                        apply(j, i, uarray2, elem, cl);
+                        elem += uarray2->size;
                 }
         }
 }
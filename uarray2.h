@@ -23,6 +23,8 @@
 typedef struct T *T;
 
 extern T    UArray2_new(int width, int height, int size);
+/* a UArray2 over elems, which it neither copies nor frees */
+extern T    UArray2_view(int width, int height, int size, void *elems);
 extern void UArray2_free(T *uarray2);
 
 extern int UArray2_width(T uarray2);
@@ -30,6 +32,7 @@ extern int UArray2_height(T uarray2);
 extern int UArray2_size(T uarray2);
 
 extern void *UArray2_at(T uarray2, int column, int row);
+extern void *UArray2_row(T uarray2, int row);
 
 extern void UArray2_map_col_major(T uarray2, void (*apply)(int column, int row,
                                 T uarray2, void *element, void *cl),
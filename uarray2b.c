@@ -10,17 +10,35 @@
  *              structure where elements are stored together in blocks. Clients
  *              can determine how large the blocks are or use the default size.
  *              It is built using a 2D Uarray where each element is block, that
- *              is a uarray of elements.
+ *              is a uarray of elements. A block may itself be divided into
+ *              tiles, each stored whole, so the array is blocked for two levels
+ *              of the memory hierarchy at once. A block whose cells all hold
+ *              the same value is kept as that one value until it is written
+ *              through UArray2b_at, and new arrays start as all such blocks.
+ *              Clones share the blocks of the array they were made from, each
+ *              block being copied the first time one of them writes it. Arrays
+ *              can be saved to a file block by block and loaded back with one
+ *              mmap, the blocks then being uarrays over the mapping. Cells
+ *              written later come from the allocator of the thread that made
+ *              the array (a2alloc.h), each block's starting on a cache line
+ *              and, with padding, staggered from the last block's.
  *
  **************************************************************/
 
 #include "uarray2.h"
 #include "uarray2b.h"
+#include "a2alloc.h"
 #include <math.h>
 #include <uarray.h>
+#include <uarrayrep.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 #define T UArray2b_T
@@ -36,7 +54,90 @@ struct T {
         int height;     /* height of 2d blocked array */
         int size;       /* the amount of bytes used by each element in the 
                          * array */
-        int blocksize;  /* the width and height of a block in the 2d array */
+        int blockWidth;         /* the columns in a block of the 2d array */
+        int blockHeight;        /* the rows in a block, equal to blockWidth
+                                 * unless made by UArray2b_new_rect */
+        int tileWidth;          /* the shape of the tiles of a block, the
+                                 * block's own unless made by */
+        int tileHeight;         /* UArray2b_new_tiled */
+        int tilesHigh;          /* tiles in a column of tiles of a block */
+        int prefetch;   /* how many blocks ahead UArray2b_map prefetches, 0
+                         * for none */
+        char *mapping;  /* the file the blocks live in if the array was
+                         * loaded by UArray2b_load, otherwise NULL */
+        size_t length;  /* bytes in the mapping */
+        int *users;     /* # of arrays using the mapping, which the last of
+                         * them unmaps; NULL until the array is cloned */
+        A2Alloc_T alloc;        /* the allocator the cells of blocks come
+                                 * from */
+        int padding;    /* cache lines the cells of each block given cells
+                         * start past those of the block before, 0 for
+                         * none (see UArray2b_set_padding) */
+        int skew;       /* lines of padding the next block given cells
+                         * gets */
+        char *values;   /* the constant values of the blocks, size bytes
+                         * each in the row-major order of the blocks, from
+                         * alloc */
+};
+
+/*
+ * The header of a file written by UArray2b_save. The blocks follow at
+ * offset, in the row-major order of the blocks, each holding all blocksize *
+ * blockHeight cells (partial blocks included) in the order given by order.
+ * Fields after offset are 0 in files saved before they were added.
+ * Fields are in the byte order of the machine that wrote the file; on a
+ * machine of the other order the version does not match and the file is
+ * refused.
+ */
+struct header {
+        char magic[8];          /* MAGIC */
+        uint32_t version;       /* VERSION */
+        uint32_t width;
+        uint32_t height;
+        uint32_t size;
+        uint32_t blocksize;     /* the columns in a block */
+        uint32_t order;         /* COLUMN_MAJOR: cell (i, j) of a block is
+                                 * at i * blockHeight + j; TILED: tiles
+                                 * of tileWidth by tileHeight cells, each
+                                 * column-major, follow one another in
+                                 * column-major order */
+        uint32_t tag;           /* the client's own, e.g. a maxval */
+        uint32_t blockHeight;   /* the rows in a block; 0, as in files of
+                                 * square blocks saved before there were
+                                 * others, means blocksize */
+        uint64_t offset;        /* bytes before the first block */
+        uint32_t tileWidth;     /* the shape of the tiles of a TILED */
+        uint32_t tileHeight;    /* block */
+};
+
+#define MAGIC "UArray2b"
+#define VERSION 1
+#define COLUMN_MAJOR 0
+#define TILED 1
+#define PAGE 4096       /* blocks start on a page boundary of the file */
+
+#define LINE 64         /* bytes in a cache line */
+
+/* the padding arrays are made with, see UArray2b_set_default_padding */
+static int defaultPadding = 0;
+
+#define TILE_BYTES 4096                 /* at most, in new_two_level: */
+#define OUTER_BYTES (256 * 1024)        /* a tile fits L1, a block L2 */
+
+/*
+ * One block of the 2d blocked array, the element type of the outer 2d
+ * array.
+ */
+struct block {
+        UArray_T cells; /* the cells in column-major order, which is rep,
+                         * or NULL while the block is constant */
+        struct UArray_T rep;    /* the uarray of the cells, kept here so a
+                                 * block costs no allocation of its own */
+        char *value;    /* the value of every cell of a constant block, in
+                         * the array's values */
+        int *refs;      /* # of arrays sharing the cells, or NULL if the
+                         * cells have never been cloned */
+        int pad;        /* bytes allocated before the first cell */
 };
 
 /* 
@@ -45,22 +146,77 @@ struct T {
  */
 typedef void (*Apply)(int col, int row, T array2b, void *elem, void *cl);
 
+/* typedef for the visit function of UArray2b_map_blocks */
+typedef int (*Visit)(int col, int row, T array2b, void *cl);
+
 /*
  * Struct to pass in multiple elements into the closure of the UArray2_map 
  * function inside the UArray2b_map function, so UArray2b_map can go through 
  * every element in a block, block by block.
  */
 struct expandedcl {
-        Apply apply;    /* apply function passed into UArray2b_map, so the apply 
-                         * function can be used on each element in a block */
+        Apply apply;    /* apply function passed into UArray2b_map, so the
+                         * apply function can be used on each element in a
+                         * block */
         void *cl;       /* original closure passed into UArray2b_map */
+        Visit visit;    /* says how each block is visited, NULL to update
+                         * every block */
         T uarray2b;     /* 2d blocked array being mapped over */
-        int blocksize;  /* blocksize of 2d blocked array being mapped over */
+        int blockWidth;         /* block shape of the 2d blocked array */
+        int blockHeight;        /* being mapped over */
+        int tileWidth;          /* and the shape of the tiles of its */
+        int tileHeight;         /* blocks */
+        int prefetch;   /* how many blocks ahead to prefetch, 0 for none */
+        char *scratch;  /* cells of a constant block being visited, NULL
+                         * until one is */
 };
 
-/********** UArray2b_new ********
+/********** newValues ********
+ *
+ * Gives an array zeroed room for the constant value of each of its blocks,
+ * from its allocator
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b, whose uarray2 of blocks is made
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - One allocation serves every block, so making an array costs no
+ *      allocation per block
+ *
+ ************************/
+static void newValues(T array2b)
+{
+        size_t bytes = (size_t) UArray2_width(array2b->array) *
+                       UArray2_height(array2b->array) * array2b->size;
+        array2b->values = array2b->alloc->alloc(array2b->alloc, bytes);
+        memset(array2b->values, 0, bytes);
+}
+
+/********** valueOf ********
+ *
+ * Finds the room for the constant value of a block
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b
+ *      int bcol, brow:         the column and row of the block among the
+ *                              blocks
+ *
+ * Return: size bytes of array2b->values
+ *
+ ************************/
+static char *valueOf(T array2b, int bcol, int brow)
+{
+        size_t index = (size_t) brow * UArray2_width(array2b->array) + bcol;
+        return array2b->values + index * array2b->size;
+}
+
+/********** UArray2b_new_tiled ********
  *
- * Creates and allocates space for a new 2D blocked UArray
+ * Creates and allocates space for a new 2D blocked UArray whose blocks are
+ * bw columns by bh rows, each divided into tiles of tw columns by th rows
  *
  * Parameters:
  *      int     width:          the number of columns in the 2D blocked UArray
@@ -68,29 +224,41 @@ struct expandedcl {
  *      int     size:           the amount of space the elements in the 2D
  *                              UArray will take up, each element will occupy
  *                              a size number bytes
- *      int     blocksize:      the width and height of each block in the 2D
+ *      int     bw, bh:         the width and height of each block in the 2D
  *                              blocked Uarray 
+ *      int     tw, th:         the width and height of each tile in a block
  *
  * Return: A pointer to the UArray2b structure that was created and malloc'd
  *
  * Expects: width and height to be non-negative (greater than or equal to 0),
- *          and for size and blocksize to positive (greater than 0)
+ *          and for size, bw, bh, tw and th to positive (greater than 0),
+ *          with tw dividing bw and th dividing bh
  *      
  * Notes: 
  *      - Calls a CRE when width and height are less than 0
  *      - Calls a CRE when size is less than 1
- *      - Calls a CRE when blocksize is less than 1
+ *      - Calls a CRE when bw or bh is less than 1 or a block has more cells
+ *      than an int counts
+ *      - Calls a CRE when the tiles do not divide the block evenly
+ *      - The cells of a tile are stored column by column, and the tiles of
+ *      a block one after another column by column, so a tile th cells high
+ *      has runs of th * size contiguous bytes
  *      - Calls a CRE if fails to allocate memory for the UArray2b
- *      - Allocates memory for the UArray2b pointer, the Uarray2 inside it, 
- *      and the uarrays representing each block for each element of the Uarray2.
+ *      - Allocates memory for the UArray2b pointer, the Uarray2 inside it
+ *      and the constant values of its blocks; the cells of a block are
+ *      allocated when the block is first written with more than one value.
  *      User is responsible for calling UArray2b_free to free this memory.
+ *      - The cells and values of blocks come from the calling thread's
+ *      allocator (see A2Alloc_use), which must outlive the array
  *      
  ************************/
-T    UArray2b_new (int width, int height, int size, int blocksize) 
+T    UArray2b_new_tiled(int width, int height, int size, int bw, int bh,
+                        int tw, int th)
 {
         assert(width >= 0 && height >= 0);
         assert(size > 0);
-        assert(blocksize > 0);
+        assert(bw > 0 && bh > 0 && bw <= INT32_MAX / bh);
+        assert(tw > 0 && th > 0 && bw % tw == 0 && bh % th == 0);
         
         T array2b = malloc(sizeof(*array2b));
         assert(array2b != NULL);
@@ -98,29 +266,41 @@ T    UArray2b_new (int width, int height, int size, int blocksize)
         array2b->width = width;
         array2b->height = height;
         array2b->size = size;
-        array2b->blocksize = blocksize;
-
-        float fwidth = width;
-        float fheight = height;
+        array2b->blockWidth = bw;
+        array2b->blockHeight = bh;
+        array2b->tileWidth = tw;
+        array2b->tileHeight = th;
+        array2b->tilesHigh = bh / th;
+        array2b->prefetch = 0;
+        array2b->mapping = NULL;
+        array2b->length = 0;
+        array2b->users = NULL;
+        array2b->alloc = A2Alloc_current();
+        array2b->padding = defaultPadding;
+        array2b->skew = 0;
 
         /* to fit every element in a block, you need the width and height of 
          * the outer 2d array to be the ceilings of the width and height of the 
-         * total 2d blocked array divided by the blocksize*/
-        array2b->array = UArray2_new(ceil(fwidth / blocksize), 
-                                     ceil(fheight / blocksize), 
-                                     sizeof(UArray_T));
+         * total 2d blocked array divided by the block width and height,
+         * computed in integers since a float cannot hold every width
+         * exactly */
+        array2b->array = UArray2_new(width / bw + (width % bw != 0),
+                                     height / bh + (height % bh != 0),
+                                     sizeof(struct block));
+        newValues(array2b);
                                      
         for (int i = 0; i < UArray2_width(array2b->array); i++)
         {
                 for (int j = 0; j < UArray2_height(array2b->array); j++)
                 {
-                        /* making and populating a uarray for each block of the u
-                         * array2b */
-                        UArray_T uarray = UArray_new(blocksize * blocksize, 
-                                                                          size);
-                        UArray_T *value = 
-                                (UArray_T *) UArray2_at(array2b->array, i, j);
-                        *value = uarray;
+                        /* every block starts constant with zeroed cells, so
+                         * its cells are only allocated once written */
+                        struct block *block =
+                                UArray2_at(array2b->array, i, j);
+                        block->cells = NULL;
+                        block->value = valueOf(array2b, i, j);
+                        block->refs = NULL;
+                        block->pad = 0;
                 }
                 
         }
@@ -128,6 +308,60 @@ T    UArray2b_new (int width, int height, int size, int blocksize)
         return array2b;
 }
 
+/********** UArray2b_new_rect ********
+ *
+ * Creates and allocates space for a new 2D blocked UArray whose blocks are
+ * bw columns by bh rows, not divided into tiles
+ *
+ * Parameters:
+ *      int     width, height:  the number of columns and rows
+ *      int     size:           the bytes in each element
+ *      int     bw, bh:         the width and height of each block
+ *
+ * Return: A pointer to the UArray2b structure that was created and malloc'd
+ *
+ * Expects: the same as UArray2b_new_tiled with tw = bw and th = bh
+ *
+ * Notes:
+ *      - Calls a CRE if any of the expectations are violated or memory
+ *      cannot be allocated
+ *      - The cells of a block are stored column by column
+ *      - User is responsible for calling UArray2b_free
+ *
+ ************************/
+T    UArray2b_new_rect(int width, int height, int size, int bw, int bh)
+{
+        return UArray2b_new_tiled(width, height, size, bw, bh, bw, bh);
+}
+
+/********** UArray2b_new ********
+ *
+ * Creates and allocates space for a new 2D blocked UArray with square blocks
+ *
+ * Parameters:
+ *      int     width:          the number of columns in the 2D blocked UArray
+ *      int     height:         the number of rows in the 2D blocked UArray
+ *      int     size:           the amount of space the elements in the 2D
+ *                              UArray will take up, each element will occupy
+ *                              a size number bytes
+ *      int     blocksize:      the width and height of each block in the 2D
+ *                              blocked Uarray
+ *
+ * Return: A pointer to the UArray2b structure that was created and malloc'd
+ *
+ * Expects: the same as UArray2b_new_rect with bw and bh both blocksize
+ *
+ * Notes:
+ *      - Calls a CRE if any of the expectations are violated or memory
+ *      cannot be allocated
+ *      - User is responsible for calling UArray2b_free
+ *
+ ************************/
+T    UArray2b_new (int width, int height, int size, int blocksize)
+{
+        return UArray2b_new_rect(width, height, size, blocksize, blocksize);
+}
+
 /********** UArray2b_new_64K_block ********
  *
  * Creates and allocates space for a new 2D blocked UArray where each block is
@@ -168,40 +402,321 @@ T  UArray2b_new_64K_block(int width, int height, int size)
         return UArray2b_new(width, height, size, blocksize);
 }
 
+/********** UArray2b_new_two_level ********
+ *
+ * Creates and allocates space for a new 2D blocked UArray whose square
+ * tiles fit in the L1 cache and whose square blocks of tiles fit in L2
+ *
+ * Parameters:
+ *      int     width:          the number of columns in the 2D blocked UArray
+ *      int     height:         the number of rows in the 2D blocked UArray
+ *      int     size:           the bytes in each element
+ *
+ * Return: A pointer to the UArray2b structure that was created and malloc'd
+ *
+ * Expects: width and height to be non-negative (greater than or equal to 0),
+ *          and for size to positive (greater than 0)
+ *
+ * Notes:
+ *      - Calls a CRE if any of the expectations are violated or memory
+ *      cannot be allocated
+ *      - Tiles are as large as possible within TILE_BYTES (4KB) and blocks
+ *      within OUTER_BYTES (256KB), a block being a whole number of tiles;
+ *      an element larger than a tile makes tiles of one element
+ *      - User is responsible for calling UArray2b_free
+ *
+ ************************/
+T  UArray2b_new_two_level(int width, int height, int size)
+{
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
+
+        int tile = sqrt(TILE_BYTES / size);
+        tile = tile > 0 ? tile : 1;
+        int blocksize = sqrt(OUTER_BYTES / size);
+        blocksize = blocksize > tile ? blocksize / tile * tile : tile;
+
+        return UArray2b_new_tiled(width, height, size, blocksize, blocksize,
+                                  tile, tile);
+}
+
+/********** mapped ********
+ *
+ * Tells whether the cells of a block are part of the file a UArray2b was
+ * loaded from rather than memory of their own
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b
+ *      UArray_T cells:         the cells of one of its blocks
+ *
+ * Return: true if the cells lie in array2b's mapping
+ *
+ ************************/
+static bool mapped(T array2b, UArray_T cells)
+{
+        char *first = UArray_at(cells, 0);
+        return array2b->mapping != NULL && first >= array2b->mapping &&
+               first < array2b->mapping + array2b->length;
+}
+
+/********** newCells ********
+ *
+ * Gives a block cells of its own from the array's allocator, starting on a
+ * cache line
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block, whose cells are replaced
+ *      bool zeroed:            whether the cells must be zero
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - With padding, the cells start array2b->skew lines into their
+ *      allocation, and the next block's start padding lines further on,
+ *      wrapping after a page
+ *
+ ************************/
+static void newCells(T array2b, struct block *block, bool zeroed)
+{
+        int count = array2b->blockWidth * array2b->blockHeight;
+        size_t bytes = (size_t) count * array2b->size;
+        int pad = array2b->skew * LINE;
+        array2b->skew = (array2b->skew + array2b->padding) % (PAGE / LINE);
+
+        char *elems = array2b->alloc->alloc(array2b->alloc, pad + bytes);
+        if (zeroed) {
+                memset(elems + pad, 0, bytes);
+        }
+        block->cells = &block->rep;
+        UArrayRep_init(block->cells, count, array2b->size, elems + pad);
+        block->pad = pad;
+}
+
+/********** freeCells ********
+ *
+ * Gives the cells of a block back to the array's allocator, leaving cells
+ * that are part of a mapping to it, and makes the block constant
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block, which must have cells
+ *
+ * Return: n/a
+ *
+ ************************/
+static void freeCells(T array2b, struct block *block)
+{
+        char *first = UArray_at(block->cells, 0);
+        if (!mapped(array2b, block->cells)) {
+                array2b->alloc->free(array2b->alloc, first - block->pad,
+                                     block->pad + (size_t) array2b->size *
+                                     UArray_length(block->cells));
+        }
+        block->cells = NULL;
+}
+
+/********** shared ********
+ *
+ * Tells whether a block's cells are shared with a clone
+ *
+ * Parameters:
+ *      struct block *block:    the block
+ *
+ * Return: true if another array uses the same cells
+ *
+ ************************/
+static bool shared(struct block *block)
+{
+        return block->refs != NULL && *block->refs > 1;
+}
+
+/********** unshare ********
+ *
+ * Drops a block's share of the cells it has in common with its clones,
+ * leaving it constant with its value, whose contents are undefined
+ *
+ * Parameters:
+ *      struct block *block:    the block, which must be shared
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - The cells are left to the clones, the last of which frees them
+ *
+ ************************/
+static void unshare(struct block *block)
+{
+        (*block->refs)--;
+        block->refs = NULL;
+        block->cells = NULL;
+}
+
+/********** own ********
+ *
+ * Gives a block cells of its own, copying them if they are shared with a
+ * clone, so it can be written
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *
+ ************************/
+static void own(T array2b, struct block *block)
+{
+        if (block->refs == NULL) {
+                return;
+        }
+        if (!shared(block)) {
+                /* the clones it was shared with are gone */
+                free(block->refs);
+                block->refs = NULL;
+                return;
+        }
+
+        const char *cells = UArray_at(block->cells, 0);
+        unshare(block);
+        newCells(array2b, block, false);
+        memcpy(UArray_at(block->cells, 0), cells,
+               (size_t) UArray_length(block->cells) * array2b->size);
+}
+
+/********** makeConstant ********
+ *
+ * Makes a block constant with a value, freeing its cells or dropping its
+ * share of them
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block
+ *      const void *value:      size bytes, which may lie in the block's
+ *                              cells or value
+ *
+ * Return: n/a
+ *
+ ************************/
+static void makeConstant(T array2b, struct block *block, const void *value)
+{
+        if (shared(block)) {
+                /* value stays valid, the clones still hold it */
+                unshare(block);
+        } else {
+                free(block->refs);
+                block->refs = NULL;
+        }
+        memmove(block->value, value, array2b->size);
+        if (block->cells != NULL) {
+                freeCells(array2b, block);
+        }
+}
+
+/********** ownCells ********
+ *
+ * Gives a block cells of its own, dropping its share of any cells it has in
+ * common with its clones, without copying anything into them
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block
+ *      bool zeroed:            whether new cells must be zero
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - Cells the block already had to itself are kept as they are; new
+ *      ones are undefined unless zeroed
+ *
+ ************************/
+static void ownCells(T array2b, struct block *block, bool zeroed)
+{
+        if (shared(block)) {
+                unshare(block);
+        } else {
+                free(block->refs);
+                block->refs = NULL;
+        }
+        if (block->cells == NULL) {
+                newCells(array2b, block, zeroed);
+        }
+}
+
+/********** setCells ********
+ *
+ * Gives a block cells of its own holding a copy of the given ones, dropping
+ * its share of any cells it has in common with its clones
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block
+ *      const char *cells:      the cells of one block in column-major
+ *                              order, not the block's own
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *
+ ************************/
+static void setCells(T array2b, struct block *block, const char *cells)
+{
+        int count = array2b->blockWidth * array2b->blockHeight;
+        ownCells(array2b, block, false);
+        memcpy(UArray_at(block->cells, 0), cells,
+               (size_t) count * array2b->size);
+}
+
 /********** vFree ********
  *
- * Frees the memory allocated the uarrays inside the Uarray2 for Uarray2b
+ * Frees the memory allocated for a block inside the Uarray2 for Uarray2b
  *
  * Parameters:
  *      int column:             current column index in 2d blocked Uarray  
  *      int row:                current row index in 2d blocked Uarray 
  *      UArray2_T uarray2:      the uarray2 that is being mapped through
- *      void *element:          the element, UArray_T, at each position in 
- *                              uarray2 
- *      void *cl:               closure for mapping function, will be voided
+ *      void *element:          the element, a struct block, at each position
+ *                              in uarray2
+ *      void *cl:               the UArray2b being freed
  * Return: n/a
  *
- * Expects: uarray2 and element to not be NULL; the column and row values not to
- *          be out of bounds of the range for the inputted 2d blocked uarray
+ * Expects: uarray2, element and cl to not be NULL; the column and row values
+ *          not to be out of bounds of the range for uarray2
  *      
  * Notes: 
  *      CRE if:
- *              - uarray2 or element is null
- *              - row is less than 0 or greater or equal to the height of the 
- *               image (number of rows of the 2d blocked uarray)
- *              - column is less than 0 or greater or equal to the width of the 
- *               image (number of columns of the 2d blocked uarray)
- *      - Frees the uarray located at (col, row) of uarray2.
+ *              - uarray2, element or cl is null
+ *              - row is less than 0 or greater or equal to the height of
+ *               uarray2
+ *              - column is less than 0 or greater or equal to the width of
+ *               uarray2
+ *      - Frees the cells of the block at (col, row) of uarray2, unless they
+ *      belong to a mapping, or only drops the block's share of them if a
+ *      clone still uses them.
  ************************/
-void vFree(int col, int row, UArray2_T uarray2, void *element, void *cl)
+static void vFree(int col, int row, UArray2_T uarray2, void *element,
+                  void *cl)
 {
-        (void) cl;
         assert(uarray2 != NULL);
         assert(element != NULL);
+        assert(cl != NULL);
         assert(col >= 0 && col < UArray2_width(uarray2));
         assert(row >= 0 && row < UArray2_height(uarray2));
 
-        UArray_free((UArray_T *)element);
+        struct block *block = element;
+        if (shared(block)) {
+                (*block->refs)--;
+                return;
+        }
+        if (block->cells != NULL) {
+                freeCells(cl, block);
+        }
+        free(block->refs);
 }
 
 /********** UArrary2b_free ********
@@ -219,7 +734,9 @@ void vFree(int col, int row, UArray2_T uarray2, void *element, void *cl)
  * Notes: 
  *      - Calls CRE when uarray2 or *uarray2b is null
  *      - Frees the memory associated with the UArray2b including its pointer 
- *      the Uarray2 in it and the uarrays inside the Uarray2.
+ *      the Uarray2 in it and the uarrays inside the Uarray2. A loaded
+ *      UArray2b has its file unmapped instead of its elements freed.
+ *      Blocks and mappings still used by a clone are left to the clone.
  ************************/
 void  UArray2b_free(T *array2b)
 {
@@ -227,7 +744,18 @@ void  UArray2b_free(T *array2b)
         assert(*array2b != NULL);
 
         /* maps through the uarray2 of blocks to free each internal uarray */
-        UArray2_map_row_major((*array2b)->array, vFree, NULL);
+        UArray2_map_row_major((*array2b)->array, vFree, *array2b);
+        (*array2b)->alloc->free((*array2b)->alloc, (*array2b)->values,
+                                (size_t) UArray2_width((*array2b)->array) *
+                                UArray2_height((*array2b)->array) *
+                                (*array2b)->size);
+        int *users = (*array2b)->users;
+        if (users != NULL && *users > 1) {
+                (*users)--;
+        } else if ((*array2b)->mapping != NULL) {
+                munmap((*array2b)->mapping, (*array2b)->length);
+                free(users);
+        }
         UArray2_free(&((*array2b)->array));
         free(&((*array2b)->array));
 }
@@ -309,7 +837,8 @@ int   UArray2b_size(T array2b)
  *      T uarray2b:     a pointer to the UArray2b_T Struct representing
  *                      the UArray2b being accessed 
  *
- * Return: the blocksize for array2b
+ * Return: the blocksize for array2b; for blocks made by UArray2b_new_rect,
+ *         their height, which is the band of rows a row of blocks covers
  *
  * Expects: uarray2b to not be NULL
  *      
@@ -320,125 +849,452 @@ int   UArray2b_size(T array2b)
 int   UArray2b_blocksize(T array2b)
 {
         assert(array2b != NULL);
-        return array2b->blocksize;
+        return array2b->blockHeight;
 }
 
-/********** UArray2b_at ********
+/********** UArray2b_block_width ********
  *
- * Retrieves a pointer to the element stored at [column, row] in uarray2b
+ * Gets the number of columns in each block of array2b
  *
  * Parameters:
- *      T       uarray2:        a pointer to the UArray2b_T Struct representing
- *                              the UArray2b being accessed
- *      int     column:         the column in the 2D blocked UArray being 
- *                              accessed
- *      int     row:            the row in the 2D blocked UArray being accessed
+ *      T array2b:      the UArray2b being accessed
  *
- * Return: void * to value at (column, row) location in 2D blocked UArray
+ * Return: the block width
  *
- * Expects: column and row to not be greater than or equal to the width and
- *          height of uarray2b or less than 0; uarray2 to not be NULL
+ * Expects: array2b to not be NULL
  *      
  * Notes: 
- *      - Calls CRE when the column and row passed in are greater than the
- *      bounds of uarray2b or if either is less than 0
- *      - Calls CRE when uarray2b is null
+ *      - Calls CRE when array2b is null
  *      
  ************************/
-void *UArray2b_at(T array2b, int column, int row)
+int   UArray2b_block_width(T array2b)
 {
         assert(array2b != NULL);
-        assert(column >= 0 && column < array2b->width);
-        assert(row >= 0 && row < array2b->height);
-        int blocksize = array2b->blocksize;
-        
-        /* gets the inner uarray where the block containing (column, row) is 
-         * stored */
-        UArray_T *inner = (UArray_T *)UArray2_at(array2b->array, 
-                                        column / blocksize , row / blocksize);
-
-        /* to get to the correct "column" in the block, then get to the 
-         * correct "row" in the block*/
-        return UArray_at(*inner, 
-                        blocksize * (column % blocksize) + (row % blocksize));
+        return array2b->blockWidth;
 }
 
-/********** Uapply ********
+/********** UArray2b_block_height ********
  *
- * Takes the current block (a uarray) from UArray2b_map and maps through every
- * element in the block. Accounts for when blocks are not completely filled
+ * Gets the number of rows in each block of array2b
  *
  * Parameters:
- *      int column:             current column index in 2d blocked Uarray  
- *      int row:                current row index in 2d blocked Uarray 
- *      UArray2_T uarray2:      the uarray2 that is being mapped through
- *      void *element:          the element, UArray_T, at each position in 
- *                              uarray2 
- *      void *cl:               closure for mapping function, should point to a
- *                              expandedcl struct
+ *      T array2b:      the UArray2b being accessed
  *
- * Return: none
+ * Return: the block height
  *
- * Expects: array2, elem, and cl to not be null; the column and row values not 
- *          to be out of bounds of the range for the inputted 2d blocked uarray;
- *          the value of bit to be 0 or 1; apply and array2b in expandedcl 
- *          bundle are not null; blocksize in expandedcl is greater than  0
+ * Expects: array2b to not be NULL
  *      
  * Notes: 
- *      CRE if:
- *              - array2, elem, or cl are null
- *              - row is less than 0 or greater or equal to the height of the 
- *               image (number of rows of the 2d blocked uarray)
- *              - column is less than 0 or greater or equal to the width of the 
- *               image (number of columns of the 2d blocked uarray)
- *              - contents of expandedcl bundle are invalid:
- *                      - apply or array2b are null
- *                      - blocksize is less than 1
+ *      - Calls CRE when array2b is null
  *      
  ************************/
-void Uapply(int col, int row, UArray2_T array2, void *elem, void *cl)
+int   UArray2b_block_height(T array2b)
 {
-
-        assert(array2 != NULL);
-        assert(elem != NULL);
-        assert(cl != NULL);
-        assert(col >= 0 && col < UArray2_width(array2));
-        assert(row >= 0 && row < UArray2_height(array2));
-        
-        UArray_T *inner = (UArray_T *)elem;
-        struct expandedcl *bundle = cl;
-        Apply apply = bundle->apply;
-        void *closure = bundle->cl;
-        int blocksize = bundle->blocksize;
-        T array2b = bundle->uarray2b;
-        
-        assert(apply != NULL);
-        assert(blocksize > 0);
         assert(array2b != NULL);
-
-
-        for (int i = 0; i < UArray_length(*inner); i++)
-        {
-                void *curr = UArray_at(*inner, i);
-                
-                int vcol = col * blocksize + (i / blocksize);
-                int vrow = row * blocksize + (i % blocksize);
-                if (vcol < array2b->width && vrow < array2b->height) {
-                        apply(vcol, vrow, array2b, curr, closure);
-                }
-
-        }
-
-        
+        return array2b->blockHeight;
 }
 
-/********** UArray2b_map ********
+/********** UArray2b_tile_width ********
  *
- * Iterates through uarray2b in a block major fashion, iterating through 
- * every element in block before going to the next one
+ * Gets the number of columns in each tile of the blocks of array2b
  *
  * Parameters:
- *      T       uarray2:        a pointer to the UArray2_T Struct representing
+ *      T array2b:      the UArray2b being accessed
+ *
+ * Return: the tile width, the block width if blocks are not divided
+ *
+ * Expects: array2b to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null
+ *
+ ************************/
+int   UArray2b_tile_width(T array2b)
+{
+        assert(array2b != NULL);
+        return array2b->tileWidth;
+}
+
+/********** UArray2b_tile_height ********
+ *
+ * Gets the number of rows in each tile of the blocks of array2b
+ *
+ * Parameters:
+ *      T array2b:      the UArray2b being accessed
+ *
+ * Return: the tile height, the block height if blocks are not divided
+ *
+ * Expects: array2b to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null
+ *
+ ************************/
+int   UArray2b_tile_height(T array2b)
+{
+        assert(array2b != NULL);
+        return array2b->tileHeight;
+}
+
+/********** materialize ********
+ *
+ * Gives a constant block cells of its own, all holding its value
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      struct block *block:    the block, which must be constant
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *
+ ************************/
+static void materialize(T array2b, struct block *block)
+{
+        int size = array2b->size;
+        int count = array2b->blockWidth * array2b->blockHeight;
+
+        /* new uarrays are zeroed, which is the value of most blocks */
+        bool zero = true;
+        for (int k = 0; k < size; k++) {
+                zero = zero && block->value[k] == 0;
+        }
+        newCells(array2b, block, zero);
+        for (int i = 0; !zero && i < count; i++) {
+                memcpy(UArray_at(block->cells, i), block->value, size);
+        }
+}
+
+/********** cellIndex ********
+ *
+ * Finds where a cell is among the cells of its block
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b
+ *      int col, row:           the column and row of the cell within its
+ *                              block
+ *
+ * Return: the index of the cell in the block's uarray
+ *
+ * Notes:
+ *      - Blocks not divided into tiles, the usual case, are column-major
+ *      without the divisions tiles take
+ *
+ ************************/
+static inline int cellIndex(T array2b, int col, int row)
+{
+        int bh = array2b->blockHeight;
+        int tw = array2b->tileWidth;
+        int th = array2b->tileHeight;
+        if (th == bh && tw == array2b->blockWidth) {
+                return bh * col + row;
+        }
+
+        int tile = (col / tw) * array2b->tilesHigh + row / th;
+        return tile * tw * th + th * (col % tw) + row % th;
+}
+
+/********** uniform ********
+ *
+ * Tells whether every cell of a block that lies within the array holds the
+ * same value
+ *
+ * Parameters:
+ *      T array2b:              the UArray2b the block belongs to
+ *      int bcol, brow:         the column and row of the block among the
+ *                              blocks
+ *      const char *cells:      the cells of the block, in the order of
+ *                              cellIndex
+ *
+ * Return: true if they do; cells outside the array, in blocks at the right
+ *         and bottom edges, are padding and do not count
+ *
+ ************************/
+static bool uniform(T array2b, int bcol, int brow, const char *cells)
+{
+        int bw = array2b->blockWidth;
+        int bh = array2b->blockHeight;
+        int size = array2b->size;
+        int cols = array2b->width - bcol * bw;
+        int rows = array2b->height - brow * bh;
+        cols = cols < bw ? cols : bw;
+        rows = rows < bh ? rows : bh;
+
+        for (int c = 0; c < cols; c++) {
+                for (int r = 0; r < rows; r++) {
+                        const char *cell = cells + (size_t) size *
+                                           cellIndex(array2b, c, r);
+                        if (memcmp(cell, cells, size) != 0) {
+                                return false;
+                        }
+                }
+        }
+        return true;
+}
+
+/********** UArray2b_at ********
+ *
+ * Retrieves a pointer to the element stored at [column, row] in uarray2b
+ *
+ * Parameters:
+ *      T       uarray2:        a pointer to the UArray2b_T Struct representing
+ *                              the UArray2b being accessed
+ *      int     column:         the column in the 2D blocked UArray being
+ *                              accessed
+ *      int     row:            the row in the 2D blocked UArray being accessed
+ *
+ * Return: void * to value at (column, row) location in 2D blocked UArray
+ *
+ * Expects: column and row to not be greater than or equal to the width and
+ *          height of uarray2b or less than 0; uarray2 to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when the column and row passed in are greater than the
+ *      bounds of uarray2b or if either is less than 0
+ *      - Calls CRE when uarray2b is null
+ *      - A constant block, or one shared with a clone, is given cells of
+ *      its own first, since the caller may write through the pointer; use
+ *      UArray2b_get to only read
+ *
+ ************************/
+void *UArray2b_at(T array2b, int column, int row)
+{
+        assert(array2b != NULL);
+        assert(column >= 0 && column < array2b->width);
+        assert(row >= 0 && row < array2b->height);
+        int bw = array2b->blockWidth;
+        int bh = array2b->blockHeight;
+
+        /* gets the block containing (column, row); the caller may write
+         * the cell, so a constant or shared block gets cells of its own
+         * first */
+        struct block *block = UArray2_at(array2b->array, column / bw,
+                                         row / bh);
+        if (block->refs != NULL) {
+                own(array2b, block);
+        }
+        if (block->cells == NULL) {
+                materialize(array2b, block);
+        }
+
+        /* to get to the correct "column" in the block, then get to the
+         * correct "row" in the block*/
+        return UArray_at(block->cells,
+                         cellIndex(array2b, column % bw, row % bh));
+}
+
+/********** UArray2b_get ********
+ *
+ * Retrieves a read-only pointer to the element stored at [column, row]
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b being accessed
+ *      int     column:         the column in the 2D blocked UArray
+ *      int     row:            the row in the 2D blocked UArray
+ *
+ * Return: a pointer to the value at (column, row), which must not be
+ *         written through
+ *
+ * Expects: the same as UArray2b_at
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Unlike UArray2b_at this leaves a constant block constant and a
+ *      shared block shared
+ *
+ ************************/
+const void *UArray2b_get(T array2b, int column, int row)
+{
+        assert(array2b != NULL);
+        assert(column >= 0 && column < array2b->width);
+        assert(row >= 0 && row < array2b->height);
+        int bw = array2b->blockWidth;
+        int bh = array2b->blockHeight;
+
+        struct block *block = UArray2_at(array2b->array, column / bw,
+                                         row / bh);
+        if (block->cells == NULL) {
+                return block->value;
+        }
+        return UArray_at(block->cells,
+                         cellIndex(array2b, column % bw, row % bh));
+}
+
+/********** Uapply ********
+ *
+ * Takes the current block (a uarray) from UArray2b_map and maps through every
+ * element in the block. Accounts for when blocks are not completely filled
+ *
+ * Parameters:
+ *      int column:             current column index in 2d blocked Uarray
+ *      int row:                current row index in 2d blocked Uarray
+ *      UArray2_T uarray2:      the uarray2 that is being mapped through
+ *      void *element:          the element, UArray_T, at each position in
+ *                              uarray2
+ *      void *cl:               closure for mapping function, should point to a
+ *                              expandedcl struct
+ *
+ * Return: none
+ *
+ * Expects: array2, elem, and cl to not be null; the column and row values not
+ *          to be out of bounds of the range for the inputted 2d blocked uarray;
+ *          the value of bit to be 0 or 1; apply and array2b in expandedcl
+ *          bundle are not null; the block shape in expandedcl is positive
+ *
+ * Notes:
+ *      CRE if:
+ *              - array2, elem, or cl are null
+ *              - row is less than 0 or greater or equal to the height of the
+ *               image (number of rows of the 2d blocked uarray)
+ *              - column is less than 0 or greater or equal to the width of the
+ *               image (number of columns of the 2d blocked uarray)
+ *              - contents of expandedcl bundle are invalid:
+ *                      - apply or array2b are null
+ *                      - the block width or height is less than 1
+ *
+ ************************/
+void Uapply(int col, int row, UArray2_T array2, void *elem, void *cl)
+{
+
+        assert(array2 != NULL);
+        assert(elem != NULL);
+        assert(cl != NULL);
+        assert(col >= 0 && col < UArray2_width(array2));
+        assert(row >= 0 && row < UArray2_height(array2));
+
+        struct block *block = elem;
+        struct expandedcl *bundle = cl;
+        Apply apply = bundle->apply;
+        void *closure = bundle->cl;
+        int bw = bundle->blockWidth;
+        int bh = bundle->blockHeight;
+        int tw = bundle->tileWidth;
+        int th = bundle->tileHeight;
+        T array2b = bundle->uarray2b;
+
+        assert(apply != NULL);
+        assert(bw > 0 && bh > 0 && tw > 0 && th > 0);
+        assert(array2b != NULL);
+
+        int how = UArray2b_UPDATE;
+        if (bundle->visit != NULL) {
+                how = bundle->visit(col * bw, row * bh, array2b, closure);
+        }
+        if (how == UArray2b_SKIP) {
+                return;
+        }
+
+        /*
+         * While this block is visited, pull the block bundle->prefetch
+         * blocks further along the traversal into the cache one line at a
+         * time, so the hardware prefetcher's lost stream at the next block
+         * boundary does not stall the traversal.
+         */
+        char *ahead = NULL;
+        if (bundle->prefetch > 0) {
+                int blocksWide = UArray2_width(array2);
+                int next = row * blocksWide + col + bundle->prefetch;
+                if (next < blocksWide * UArray2_height(array2)) {
+                        struct block *aheadBlock = UArray2_at(array2,
+                                                        next % blocksWide,
+                                                        next / blocksWide);
+                        if (aheadBlock->cells != NULL) {
+                                ahead = UArray_at(aheadBlock->cells, 0);
+                        }
+                }
+        }
+        int size = array2b->size;
+        int perLine = size < LINE ? LINE / size : 1;
+        int count = bw * bh;
+
+        /*
+         * A block apply writes without reading gets cells of its own that
+         * apply writes in place, zeroed only if some of them lie past the
+         * edge of the array and are never visited. A block apply only
+         * reads is visited where it is, every cell of a constant block
+         * being its value. Otherwise a constant block, or one shared with
+         * a clone, is visited through a copy in scratch: a constant block
+         * stays constant if the cells still all hold one value afterwards,
+         * and a shared one stays shared if apply wrote nothing; otherwise
+         * the copy becomes cells of the block's own.
+         */
+        bool share = shared(block);
+        char *cells;
+        size_t step = size;
+        if (how == UArray2b_WRITE) {
+                ownCells(array2b, block, (col + 1) * bw > array2b->width ||
+                                         (row + 1) * bh > array2b->height);
+                cells = UArray_at(block->cells, 0);
+        } else if (how == UArray2b_READ && block->cells == NULL) {
+                cells = block->value;
+                step = 0;
+        } else if (block->cells != NULL &&
+                   (!share || how == UArray2b_READ)) {
+                cells = UArray_at(block->cells, 0);
+        } else {
+                if (bundle->scratch == NULL) {
+                        bundle->scratch = malloc((size_t) count * size);
+                        assert(bundle->scratch != NULL);
+                }
+                cells = bundle->scratch;
+                if (block->cells != NULL) {
+                        memcpy(cells, UArray_at(block->cells, 0),
+                               (size_t) count * size);
+                }
+                for (int i = 0; block->cells == NULL && i < count; i++) {
+                        memcpy(cells + (size_t) i * size, block->value, size);
+                }
+        }
+
+        /* the cells are visited in the order they are stored: tile by
+         * tile down the columns of tiles, and within a tile column by
+         * column */
+        int i = 0;
+        for (int tc = 0; tc < bw; tc += tw) {
+                for (int tr = 0; tr < bh; tr += th) {
+                        for (int c = tc; c < tc + tw; c++) {
+                                int vcol = col * bw + c;
+                                for (int r = tr; r < tr + th; r++, i++) {
+                                        void *curr = cells + i * step;
+                                        if (ahead != NULL && i % perLine == 0) {
+                                                __builtin_prefetch(ahead +
+                                                        (size_t) i * size);
+                                        }
+
+                                        int vrow = row * bh + r;
+                                        if (vcol < array2b->width &&
+                                            vrow < array2b->height) {
+                                                apply(vcol, vrow, array2b,
+                                                      curr, closure);
+                                        }
+                                }
+                        }
+                }
+        }
+
+        if (how != UArray2b_UPDATE) {
+                return;
+        }
+        if (block->cells == NULL) {
+                if (!uniform(array2b, col, row, cells)) {
+                        setCells(array2b, block, cells);
+                } else if (memcmp(block->value, cells, size) != 0) {
+                        makeConstant(array2b, block, cells);
+                }
+        } else if (share && memcmp(UArray_at(block->cells, 0), cells,
+                                   (size_t) count * size) != 0) {
+                setCells(array2b, block, cells);
+        }
+}
+
+/********** UArray2b_map ********
+ *
+ * Iterates through uarray2b in a block major fashion, iterating through
+ * every element in block before going to the next one
+ *
+ * Parameters:
+ *      T       uarray2:        a pointer to the UArray2_T Struct representing
  *                              the UArray2 being accessed
  *
  *      void (*apply):          a function pointer that represents the function
@@ -464,12 +1320,53 @@ void Uapply(int col, int row, UArray2_T array2, void *elem, void *cl)
  *      - Calls CRE when uarray2b is null
  *      - Calls CRE when apply is null
  *      - Allocates and frees memory for expandedcl struct
+ *      - apply may write the elements of a constant block; the block only
+ *      gets cells of its own if it no longer holds a single value. A block
+ *      shared with a clone is only copied if apply changes it.
  *      
  ************************/
 void  UArray2b_map(T array2b, 
                 void (*apply)(int col, int row, T array2b, void *elem, 
                                                                       void *cl),
                 void *cl)
+{
+        UArray2b_map_blocks(array2b, NULL, apply, cl);
+}
+
+/********** UArray2b_map_blocks ********
+ *
+ * Iterates through uarray2b block by block as UArray2b_map does, asking
+ * visit first how each block is to be visited
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b being mapped over
+ *      int (*visit):           called with the first column and row of each
+ *                              block, array2b and cl; returns UArray2b_SKIP,
+ *                              UArray2b_READ, UArray2b_WRITE or
+ *                              UArray2b_UPDATE (see uarray2b.h). NULL
+ *                              updates every block
+ *      void (*apply):          the function called on each cell, as for
+ *                              UArray2b_map
+ *      void *cl:               the closure passed to visit and apply
+ *
+ * Return: none
+ *
+ * Expects: array2b and apply to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when array2b or apply is null
+ *      - A skipped block is neither visited nor prefetched, and a block
+ *      read or written costs no scratch copy and no check of its cells
+ *      afterwards. visit must be right: apply is given the cells of a
+ *      block read even if they are shared, and the cells of a block
+ *      written that apply does not write are undefined
+ *
+ ************************/
+void  UArray2b_map_blocks(T array2b,
+                          int visit(int col, int row, T array2b, void *cl),
+                          void apply(int col, int row, T array2b, void *elem,
+                                     void *cl),
+                          void *cl)
 {
         assert(array2b != NULL);
         assert(apply != NULL);
@@ -480,7 +1377,7 @@ void  UArray2b_map(T array2b,
          *      - The apply function, so it actually runs on each element
          *      - the closure, if the client is passing in their own closure
          *      that needs to get accessed by the elements of Uarrayb
-         *      - the blocksize of the array2b, to find the row/col of the 
+         *      - the block shape of the array2b, to find the row/col of the
          *      Uarray2b using row/col of the outer Uarray2 and the current 
          *      index of the inner uarray
          *      - the array2b
@@ -489,12 +1386,530 @@ void  UArray2b_map(T array2b,
         assert(bundle != NULL);
         bundle->apply = apply;
         bundle->cl = cl;
-        bundle->blocksize = array2b->blocksize;
+        bundle->visit = visit;
+        bundle->blockWidth = array2b->blockWidth;
+        bundle->blockHeight = array2b->blockHeight;
+        bundle->tileWidth = array2b->tileWidth;
+        bundle->tileHeight = array2b->tileHeight;
         bundle->uarray2b = array2b;
+        bundle->prefetch = array2b->prefetch;
+        bundle->scratch = NULL;
         
         UArray2_map_row_major(array2b->array, Uapply, bundle);
 
+        free(bundle->scratch);
         free(bundle);
 }
 
-#undef T
\ No newline at end of file
+/********** UArray2b_set_prefetch ********
+ *
+ * Sets how many blocks ahead of the block being visited UArray2b_map
+ * prefetches
+ *
+ * Parameters:
+ *      T       array2b:        a pointer to the UArray2b_T Struct representing
+ *                              the UArray2b being accessed
+ *      int     distance:       the number of blocks to look ahead, 0 to turn
+ *                              prefetching off
+ *
+ * Return: none
+ *
+ * Expects: array2b to not be NULL and distance to be non-negative
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null or distance is negative
+ *
+ ************************/
+void UArray2b_set_prefetch(T array2b, int distance)
+{
+        assert(array2b != NULL);
+        assert(distance >= 0);
+        array2b->prefetch = distance;
+}
+
+/********** UArray2b_set_padding ********
+ *
+ * Sets how far apart within their allocations the cells of blocks given
+ * cells from now on start
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b being accessed
+ *      int     lines:          cache lines each block's cells start past
+ *                              the last block's, 0 for none
+ *
+ * Return: none
+ *
+ * Expects: array2b to not be NULL and lines to be non-negative
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null or lines is negative
+ *      - Blocks of a power-of-two size allocated one after another
+ *      otherwise start at the same place relative to a page, so the same
+ *      cell of neighbouring blocks falls in the same cache set; padding
+ *      staggers them at the cost of up to a page per block (with a pool
+ *      allocator, the next size class up)
+ *      - New blocks hold no cells, so padding set right after the array
+ *      is made covers every block
+ *
+ ************************/
+void UArray2b_set_padding(T array2b, int lines)
+{
+        assert(array2b != NULL);
+        assert(lines >= 0);
+        array2b->padding = lines % (PAGE / LINE);
+}
+
+/********** UArray2b_set_default_padding ********
+ *
+ * Sets the padding (see UArray2b_set_padding) of arrays made or loaded
+ * from now on
+ *
+ * Parameters:
+ *      int     lines:          cache lines of padding, 0 (the default) for
+ *                              none
+ *
+ * Return: none
+ *
+ * Expects: lines to be non-negative
+ *
+ * Notes:
+ *      - Calls CRE when lines is negative
+ *
+ ************************/
+void UArray2b_set_default_padding(int lines)
+{
+        assert(lines >= 0);
+        defaultPadding = lines % (PAGE / LINE);
+}
+
+/********** dedupBlock ********
+ *
+ * Makes a block whose cells all hold the same value constant
+ *
+ * Parameters:
+ *      int column:             current column index in the Uarray2
+ *      int row:                current row index in the Uarray2
+ *      UArray2_T uarray2:      the uarray2 of blocks
+ *      void *element:          the block, a struct block
+ *      void *cl:               the UArray2b
+ *
+ * Return: n/a
+ *
+ ************************/
+static void dedupBlock(int col, int row, UArray2_T uarray2, void *element,
+                       void *cl)
+{
+        (void) uarray2;
+        struct block *block = element;
+        T array2b = cl;
+
+        if (block->cells != NULL &&
+            uniform(array2b, col, row, UArray_at(block->cells, 0))) {
+                makeConstant(array2b, block, UArray_at(block->cells, 0));
+        }
+}
+
+/********** UArray2b_dedup ********
+ *
+ * Finds the blocks whose cells all hold the same value and frees their
+ * cells, keeping the one value
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b
+ *
+ * Return: none
+ *
+ * Expects: array2b to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null
+ *      - Blocks filled by UArray2b_map are found as they are filled; this
+ *      is for arrays filled through UArray2b_at
+ *
+ ************************/
+void UArray2b_dedup(T array2b)
+{
+        assert(array2b != NULL);
+        UArray2_map_row_major(array2b->array, dedupBlock, array2b);
+}
+
+/********** UArray2b_constant ********
+ *
+ * Gets the value of the block holding [column, row] if it is constant
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b
+ *      int     column, row:    a cell of the block
+ *
+ * Return: a read-only pointer to the value of every cell of the block, or
+ *         NULL if the block has cells of its own
+ *
+ * Expects: the same as UArray2b_at
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+const void *UArray2b_constant(T array2b, int column, int row)
+{
+        assert(array2b != NULL);
+        assert(column >= 0 && column < array2b->width);
+        assert(row >= 0 && row < array2b->height);
+        struct block *block = UArray2_at(array2b->array,
+                                         column / array2b->blockWidth,
+                                         row / array2b->blockHeight);
+        return block->cells == NULL ? block->value : NULL;
+}
+
+/********** UArray2b_fill_block ********
+ *
+ * Sets every cell of the block holding [column, row] to one value, making
+ * the block constant
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b
+ *      int     column, row:    a cell of the block
+ *      const void *value:      size bytes to copy into every cell
+ *
+ * Return: none
+ *
+ * Expects: the same as UArray2b_at, and value to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - The block's own cells, if it had any, are freed; cells shared
+ *      with a clone are left to it
+ *
+ ************************/
+void UArray2b_fill_block(T array2b, int column, int row, const void *value)
+{
+        assert(array2b != NULL && value != NULL);
+        assert(column >= 0 && column < array2b->width);
+        assert(row >= 0 && row < array2b->height);
+        struct block *block = UArray2_at(array2b->array,
+                                         column / array2b->blockWidth,
+                                         row / array2b->blockHeight);
+        makeConstant(array2b, block, value);
+}
+
+/********** shareBlock ********
+ *
+ * Makes a block of a clone share the cells of the corresponding block of
+ * the array it is cloned from, or hold the same value if it is constant
+ *
+ * Parameters:
+ *      int column:             current column index in the Uarray2
+ *      int row:                current row index in the Uarray2
+ *      UArray2_T uarray2:      the uarray2 of blocks of the original
+ *      void *element:          the block of the original, a struct block
+ *      void *cl:               the clone, whose values are a copy of the
+ *                              original's
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *
+ ************************/
+static void shareBlock(int col, int row, UArray2_T uarray2, void *element,
+                       void *cl)
+{
+        (void) uarray2;
+        struct block *block = element;
+        T clone = cl;
+        struct block *copy = UArray2_at(clone->array, col, row);
+
+        *copy = *block;
+        copy->value = valueOf(clone, col, row);
+        if (block->cells == NULL) {
+                return;
+        }
+        if (block->refs == NULL) {
+                block->refs = malloc(sizeof(*block->refs));
+                assert(block->refs != NULL);
+                *block->refs = 1;
+        }
+        (*block->refs)++;
+        copy->refs = block->refs;
+        copy->cells = &copy->rep;
+}
+
+/********** UArray2b_clone ********
+ *
+ * Makes a copy of array2b that shares its blocks until either is written
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b to copy
+ *
+ * Return: a new UArray2b with the same shape, cells and prefetch distance
+ *
+ * Expects: array2b to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE when array2b is null or memory cannot be allocated
+ *      - Costs one reference count per block, however large the blocks
+ *      are, and one copy of the values of the constant blocks; a block is
+ *      copied the first time the original or a clone writes it through
+ *      UArray2b_at or UArray2b_map, so memory grows with the blocks that
+ *      are changed only
+ *      - A clone of a loaded array shares its mapping, which is unmapped
+ *      when the last of them is freed
+ *      - User is responsible for calling UArray2b_free on the clone
+ *
+ ************************/
+T UArray2b_clone(T array2b)
+{
+        assert(array2b != NULL);
+
+        T clone = malloc(sizeof(*clone));
+        assert(clone != NULL);
+        *clone = *array2b;
+        clone->array = UArray2_new(UArray2_width(array2b->array),
+                                   UArray2_height(array2b->array),
+                                   sizeof(struct block));
+        newValues(clone);
+        memcpy(clone->values, array2b->values,
+               (size_t) UArray2_width(array2b->array) *
+               UArray2_height(array2b->array) * array2b->size);
+        UArray2_map_row_major(array2b->array, shareBlock, clone);
+
+        if (array2b->mapping != NULL) {
+                if (array2b->users == NULL) {
+                        array2b->users = malloc(sizeof(*array2b->users));
+                        assert(array2b->users != NULL);
+                        *array2b->users = 1;
+                }
+                (*array2b->users)++;
+                clone->users = array2b->users;
+        }
+        return clone;
+}
+
+/*
+ * Struct to pass the file and the shape of the blocks into saveBlock.
+ */
+struct saveCl {
+        FILE *fp;
+        int count;      /* cells in a block */
+        int size;       /* bytes in a cell */
+};
+
+/********** saveBlock ********
+ *
+ * Writes the cells of one block, padding included, to a file
+ *
+ * Parameters:
+ *      int column:             current column index in the Uarray2
+ *      int row:                current row index in the Uarray2
+ *      UArray2_T uarray2:      the uarray2 of blocks
+ *      void *element:          the block, a struct block
+ *      void *cl:               the struct saveCl of the array
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if the write fails
+ *      - A constant block is written as its value repeated
+ *
+ ************************/
+static void saveBlock(int col, int row, UArray2_T uarray2, void *element,
+                      void *cl)
+{
+        (void) col;
+        (void) row;
+        (void) uarray2;
+        struct block *block = element;
+        struct saveCl *save = cl;
+
+        size_t bytes = (size_t) save->count * save->size;
+        size_t written = 0;
+        if (block->cells == NULL) {
+                for (int i = 0; i < save->count; i++) {
+                        written += fwrite(block->value, 1, save->size,
+                                          save->fp);
+                }
+        } else {
+                written = fwrite(UArray_at(block->cells, 0), 1, bytes,
+                                 save->fp);
+        }
+        assert(written == bytes);
+        (void) written;
+}
+
+/********** UArray2b_save ********
+ *
+ * Writes array2b to a file in a form UArray2b_load can map back
+ *
+ * Parameters:
+ *      T       array2b:        the UArray2b being saved
+ *      FILE    *fp:            the file, positioned where the array goes
+ *                              (normally its start)
+ *      unsigned tag:           a number saved with the array for the
+ *                              client, such as the maxval of an image
+ *
+ * Return: none
+ *
+ * Expects: array2b and fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if array2b or fp is NULL or a write fails
+ *      - The header (see struct header) is padded to PAGE bytes and the
+ *      blocks follow as they are in memory, so saving is one write per
+ *      block and loading parses nothing but the header
+ *
+ ************************/
+void UArray2b_save(T array2b, FILE *fp, unsigned tag)
+{
+        assert(array2b != NULL);
+        assert(fp != NULL);
+
+        char page[PAGE];
+        struct header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.width = array2b->width;
+        header.height = array2b->height;
+        header.size = array2b->size;
+        header.blocksize = array2b->blockWidth;
+        header.blockHeight = array2b->blockHeight;
+        header.order = COLUMN_MAJOR;
+        if (array2b->tileWidth != array2b->blockWidth ||
+            array2b->tileHeight != array2b->blockHeight) {
+                header.order = TILED;
+                header.tileWidth = array2b->tileWidth;
+                header.tileHeight = array2b->tileHeight;
+        }
+        header.tag = tag;
+        header.offset = PAGE;
+        memset(page, 0, sizeof(page));
+        memcpy(page, &header, sizeof(header));
+
+        size_t written = fwrite(page, 1, PAGE, fp);
+        assert(written == PAGE);
+        struct saveCl save = {
+                fp, array2b->blockWidth * array2b->blockHeight, array2b->size
+        };
+        UArray2_map_row_major(array2b->array, saveBlock, &save);
+        int flushed = fflush(fp);
+        assert(flushed == 0);
+        (void) written;
+        (void) flushed;
+}
+
+/********** UArray2b_load ********
+ *
+ * Maps a file written by UArray2b_save as a UArray2b
+ *
+ * Parameters:
+ *      FILE    *fp:            the file, which must be a regular file
+ *      unsigned *tag:          where the tag saved with the array goes, or
+ *                              NULL if it is not wanted
+ *
+ * Return: the UArray2b, whose blocks are read from and written to a private
+ *         mapping of the file, or NULL if fp is not a regular file holding a
+ *         complete saved UArray2b. Nothing is read from fp either way.
+ *
+ * Expects: fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if fp is NULL or memory cannot be allocated
+ *      - Writes through the array change the mapping, never the file
+ *      - Only the header is checked and no cell is touched, so loading
+ *      costs one pass over the blocks whatever the size of the image
+ *      - User is responsible for calling UArray2b_free, which unmaps the
+ *      file
+ *
+ ************************/
+T UArray2b_load(FILE *fp, unsigned *tag)
+{
+        assert(fp != NULL);
+
+        struct stat info;
+        if (fstat(fileno(fp), &info) != 0 || !S_ISREG(info.st_mode) ||
+            (size_t) info.st_size < sizeof(struct header)) {
+                return NULL;
+        }
+        size_t length = info.st_size;
+        char *mapping = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE, fileno(fp), 0);
+        if (mapping == MAP_FAILED) {
+                return NULL;
+        }
+
+        struct header header;
+        memcpy(&header, mapping, sizeof(header));
+        uint64_t blocksWide = 0, blocksHigh = 0, blockBytes = 0;
+        uint64_t blockHeight = header.blockHeight != 0 ? header.blockHeight
+                                                       : header.blocksize;
+        uint64_t cells = (uint64_t) header.blocksize * blockHeight;
+        bool tiled = header.order == TILED;
+        uint64_t tileWidth = tiled ? header.tileWidth : header.blocksize;
+        uint64_t tileHeight = tiled ? header.tileHeight : blockHeight;
+        bool valid = memcmp(header.magic, MAGIC, sizeof(header.magic)) == 0 &&
+                     header.version == VERSION &&
+                     (header.order == COLUMN_MAJOR || tiled) &&
+                     header.width <= INT32_MAX &&
+                     header.height <= INT32_MAX &&
+                     header.size > 0 && header.size <= INT32_MAX &&
+                     cells > 0 && cells <= INT32_MAX &&
+                     tileWidth > 0 && header.blocksize % tileWidth == 0 &&
+                     tileHeight > 0 && blockHeight % tileHeight == 0 &&
+                     header.offset >= sizeof(header) &&
+                     header.offset % PAGE == 0;
+        if (valid) {
+                blocksWide = (header.width + header.blocksize - 1) /
+                             header.blocksize;
+                blocksHigh = (header.height + blockHeight - 1) / blockHeight;
+                blockBytes = cells * header.size;
+                valid = header.offset + blocksWide * blocksHigh * blockBytes
+                        <= length;
+        }
+        if (!valid) {
+                munmap(mapping, length);
+                return NULL;
+        }
+
+        T array2b = malloc(sizeof(*array2b));
+        assert(array2b != NULL);
+        array2b->width = header.width;
+        array2b->height = header.height;
+        array2b->size = header.size;
+        array2b->blockWidth = header.blocksize;
+        array2b->blockHeight = blockHeight;
+        array2b->tileWidth = tileWidth;
+        array2b->tileHeight = tileHeight;
+        array2b->tilesHigh = blockHeight / tileHeight;
+        array2b->prefetch = 0;
+        array2b->mapping = mapping;
+        array2b->length = length;
+        array2b->users = NULL;
+        array2b->alloc = A2Alloc_current();
+        array2b->padding = defaultPadding;
+        array2b->skew = 0;
+        array2b->array = UArray2_new(blocksWide, blocksHigh,
+                                     sizeof(struct block));
+        newValues(array2b);
+
+        char *elems = mapping + header.offset;
+        for (uint64_t j = 0; j < blocksHigh; j++) {
+                for (uint64_t i = 0; i < blocksWide; i++) {
+                        struct block *block = UArray2_at(array2b->array,
+                                                         i, j);
+                        block->cells = &block->rep;
+                        block->value = valueOf(array2b, i, j);
+                        block->refs = NULL;
+                        block->pad = 0;
+                        UArrayRep_init(block->cells, cells, header.size,
+                                       elems);
+                        elems += blockBytes;
+                }
+        }
+
+        if (tag != NULL) {
+                *tag = header.tag;
+        }
+        return array2b;
+}
+
+#undef T
@@ -0,0 +1,137 @@
+/**************************************************************
+ *
+ *                     uarray2b.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    2-20-25
+ *
+ *     Summary: The interface for a 2D version of Hanson's UArray data
+ *              structure where elements are stored together in blocks. It
+ *              keeps every function of the course supplied interface and adds
+ *              tuning knobs for block-major traversals.
+ *
+ **************************************************************/
+
+#ifndef UARRAY2B_INCLUDED
+#define UARRAY2B_INCLUDED
+
+#include <stdio.h>
+
+#define T UArray2b_T
+typedef struct T *T;
+
+/* new blocked 2d array: blocksize = square root of # of cells in block */
+extern T    UArray2b_new (int width, int height, int size, int blocksize);
+
+/* new blocked 2d array of blocks bw cells wide and bh high; the cells of a
+ * block are stored column by column */
+extern T    UArray2b_new_rect(int width, int height, int size, int bw,
+                              int bh);
+
+/* new blocked 2d array whose bw x bh blocks are divided into tiles of tw x
+ * th cells (tw dividing bw, th dividing bh); each tile is stored whole,
+ * column by column, and the tiles of a block follow one another column by
+ * column, so UArray2b_map visits blocks, tiles within them, then cells */
+extern T    UArray2b_new_tiled(int width, int height, int size, int bw,
+                               int bh, int tw, int th);
+
+/* new blocked 2d array: blocksize as large as possible provided
+ * block occupies at most 64KB (if possible)
+ */
+extern T    UArray2b_new_64K_block(int width, int height, int size);
+
+/* new two-level blocked 2d array: square tiles of at most 4KB (L1) in
+ * square blocks of at most 256KB (L2) */
+extern T    UArray2b_new_two_level(int width, int height, int size);
+
+extern void  UArray2b_free     (T *array2b);
+
+extern int   UArray2b_width    (T  array2b);
+extern int   UArray2b_height   (T  array2b);
+extern int   UArray2b_size     (T  array2b);
+extern int   UArray2b_blocksize(T  array2b);     /* the block height */
+extern int   UArray2b_block_width (T array2b);
+extern int   UArray2b_block_height(T array2b);
+extern int   UArray2b_tile_width  (T array2b);
+extern int   UArray2b_tile_height (T array2b);
+
+/* return a pointer to the cell in the given column and row.
+ * index out of range is a checked run-time error
+ */
+extern void *UArray2b_at(T array2b, int column, int row);
+
+/* as UArray2b_at, but the cell must only be read; a block whose cells all
+ * hold one value stays stored as that value */
+extern const void *UArray2b_get(T array2b, int column, int row);
+
+/* the value of the block holding the cell if the block is constant (stored
+ * as one value), else NULL; new blocks are constant zero, blocks filled by
+ * UArray2b_map with one value stay constant, UArray2b_at makes a block
+ * store every cell */
+extern const void *UArray2b_constant(T array2b, int column, int row);
+
+/* makes the block holding the cell constant with value */
+extern void  UArray2b_fill_block(T array2b, int column, int row,
+                                 const void *value);
+
+/* makes every block whose cells hold one value constant */
+extern void  UArray2b_dedup(T array2b);
+
+/* a copy of array2b made in time proportional to its number of blocks: the
+ * two share every block until one of them writes it through UArray2b_at or
+ * UArray2b_map, which then copies that block alone */
+extern T     UArray2b_clone(T array2b);
+
+/* visits every cell in one block before moving to another block */
+extern void  UArray2b_map(T array2b,
+                          void apply(int col, int row, T array2b,
+                                     void *elem, void *cl),
+                          void *cl);
+
+/* what UArray2b_map_blocks does with a block */
+#define UArray2b_SKIP   0       /* nothing: apply is not called on it */
+#define UArray2b_READ   1       /* apply only reads the cells, so a constant
+                                 * or shared block stays as it is at no
+                                 * cost, and every cell of a constant block
+                                 * is its one value */
+#define UArray2b_WRITE  2       /* apply writes every cell without reading
+                                 * it, so the block gets cells of its own
+                                 * and apply writes them in place */
+#define UArray2b_UPDATE 3       /* as UArray2b_map */
+
+/* as UArray2b_map, but visit is called first with the first column and row
+ * of each block and returns one of the above for it; a skipped block costs
+ * nothing but the call */
+extern void  UArray2b_map_blocks(T array2b,
+                                 int visit(int col, int row, T array2b,
+                                           void *cl),
+                                 void apply(int col, int row, T array2b,
+                                            void *elem, void *cl),
+                                 void *cl);
+
+/* number of blocks UArray2b_map prefetches ahead of the block it is
+ * visiting; 0 (the default) turns software prefetching off
+ */
+extern void  UArray2b_set_prefetch(T array2b, int distance);
+
+/* the cells of blocks start on a cache line; with padding, each block given
+ * cells starts lines cache lines further into its allocation than the one
+ * before (wrapping at a page), so neighbouring blocks of a power-of-two
+ * size do not map to the same cache sets. 0 (the default) for none; the
+ * default applies to arrays made or loaded after it is set
+ */
+extern void  UArray2b_set_padding(T array2b, int lines);
+extern void  UArray2b_set_default_padding(int lines);
+
+/* writes array2b to fp with tag, a number kept for the client (e.g. a
+ * maxval); the blocks are written as they are in memory */
+extern void  UArray2b_save(T array2b, FILE *fp, unsigned tag);
+
+/* maps a file written by UArray2b_save, parsing only its header; NULL if fp
+ * is not a regular file holding a saved UArray2b, in which case nothing has
+ * been read from fp */
+extern T     UArray2b_load(FILE *fp, unsigned *tag);
+
+#undef T
+#endif
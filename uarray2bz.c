@@ -0,0 +1,645 @@
+/**************************************************************
+ *
+ *                     uarray2bz.c
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The implementation of a blocked 2D array whose blocks are
+ *              kept compressed. Cells are ordered within a block as in
+ *              UArray2b. A block is compressed by replacing every cell with
+ *              its bytewise difference from the cell before it and run
+ *              length coding the differences a whole cell at a time, so flat
+ *              regions and smooth gradients shrink to a few bytes. A cache of
+ *              a few decompressed blocks, evicting the least recently used,
+ *              serves UArray2bz_at and UArray2bz_map.
+ *
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "assert.h"
+#include "uarray2bz.h"
+
+#define T UArray2bz_T
+
+#define LITERALS 128    /* most cells copied after one control byte */
+#define REPEATS 129     /* most copies of a cell after one control byte */
+
+/*
+ * One block: its cells compressed, or as they are if compressing did not
+ * make them smaller.
+ */
+struct block {
+        char *data;     /* NULL while the block has never left the cache,
+                         * which means its cells are all zero */
+        int bytes;      /* bytes in data */
+        bool stored;    /* data holds the cells themselves */
+        int slot;       /* the cache slot holding the block, -1 if none */
+};
+
+/*
+ * One cache slot: a decompressed block.
+ */
+struct slot {
+        int block;              /* the block held, -1 if none */
+        bool dirty;             /* the cells may have been written since
+                                 * they were loaded */
+        int pins;               /* maps visiting the block; pinned slots are
+                                 * not evicted */
+        unsigned long used;     /* the clock when the block was last used */
+        char *cells;
+        char *clean;            /* the cells as the block's data holds them,
+                                 * so a dirty slot nothing was written to is
+                                 * not compressed again */
+};
+
+struct T {
+        int width;
+        int height;
+        int size;               /* bytes in a cell */
+        int blocksize;          /* the width and height of a block */
+        int blocksWide;         /* blocks in a row of blocks */
+        int blocksHigh;         /* rows of blocks */
+        size_t blockBytes;      /* bytes in a decompressed block */
+        struct block *blocks;   /* row-major order of blocks */
+        struct slot *slots;
+        int cached;             /* slots in the cache */
+        unsigned long clock;    /* ticks once per use of a block */
+        size_t compressed;      /* bytes in the data of all blocks */
+        unsigned long hits;     /* uses that found the block cached */
+        unsigned long misses;   /* uses that decompressed the block */
+        char *deltas;           /* scratch for compressing, blockBytes */
+        char *packed;           /* scratch for compressing, the worst case
+                                 * for a block: a control byte per cell */
+};
+
+/********** UArray2bz_new ********
+ *
+ * Creates a compressed blocked 2D array whose cells are all zero
+ *
+ * Parameters:
+ *      int     width:          the number of columns in the array
+ *      int     height:         the number of rows in the array
+ *      int     size:           the number of bytes in a cell
+ *      int     blocksize:      the width and height of each block
+ *      int     cached:         how many blocks are kept decompressed
+ *
+ * Return: the new array
+ *
+ * Expects: width and height to be non-negative, size and blocksize to be
+ *          positive and cached to be at least 2
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *      be allocated
+ *      - No block has any data until it is evicted from the cache, so a new
+ *      array costs its cache and a few words per block
+ *      - User is responsible for calling UArray2bz_free
+ *
+ ************************/
+T UArray2bz_new(int width, int height, int size, int blocksize, int cached)
+{
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
+        assert(blocksize > 0);
+        assert(cached >= 2);
+
+        T array = malloc(sizeof(*array));
+        assert(array != NULL);
+        array->width = width;
+        array->height = height;
+        array->size = size;
+        array->blocksize = blocksize;
+        array->blocksWide = (width + blocksize - 1) / blocksize;
+        array->blocksHigh = (height + blocksize - 1) / blocksize;
+        array->blockBytes = (size_t) blocksize * blocksize * size;
+        array->cached = cached;
+        array->clock = 0;
+        array->compressed = 0;
+        array->hits = 0;
+        array->misses = 0;
+
+        size_t count = (size_t) array->blocksWide * array->blocksHigh;
+        array->blocks = malloc((count > 0 ? count : 1) *
+                               sizeof(*array->blocks));
+        assert(array->blocks != NULL);
+        for (size_t b = 0; b < count; b++) {
+                array->blocks[b].data = NULL;
+                array->blocks[b].bytes = 0;
+                array->blocks[b].stored = false;
+                array->blocks[b].slot = -1;
+        }
+
+        array->slots = malloc(cached * sizeof(*array->slots));
+        assert(array->slots != NULL);
+        for (int s = 0; s < cached; s++) {
+                array->slots[s].block = -1;
+                array->slots[s].dirty = false;
+                array->slots[s].pins = 0;
+                array->slots[s].used = 0;
+                array->slots[s].cells = malloc(array->blockBytes);
+                array->slots[s].clean = malloc(array->blockBytes);
+                assert(array->slots[s].cells != NULL &&
+                       array->slots[s].clean != NULL);
+        }
+
+        array->deltas = malloc(array->blockBytes);
+        array->packed = malloc(array->blockBytes + blocksize * blocksize);
+        assert(array->deltas != NULL && array->packed != NULL);
+
+        return array;
+}
+
+/********** UArray2bz_new_64K_block ********
+ *
+ * Creates a compressed blocked 2D array whose blocks are as large as
+ * possible provided a decompressed block occupies at most 64KB
+ *
+ * Parameters:
+ *      int     width:          the number of columns in the array
+ *      int     height:         the number of rows in the array
+ *      int     size:           the number of bytes in a cell
+ *      int     cached:         how many blocks are kept decompressed
+ *
+ * Return: the new array
+ *
+ * Expects: as UArray2bz_new
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated or memory cannot
+ *      be allocated
+ *
+ ************************/
+T UArray2bz_new_64K_block(int width, int height, int size, int cached)
+{
+        assert(size > 0);
+        int blocksize = sqrt(1024 * 64 / size);
+
+        return UArray2bz_new(width, height, size,
+                             blocksize > 0 ? blocksize : 1, cached);
+}
+
+/********** UArray2bz_free ********
+ *
+ * Frees a compressed blocked 2D array
+ *
+ * Parameters:
+ *      T *array2bz:    a pointer to the array
+ *
+ * Return: n/a
+ *
+ * Expects: array2bz and *array2bz to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *
+ ************************/
+void UArray2bz_free(T *array2bz)
+{
+        assert(array2bz != NULL && *array2bz != NULL);
+        T array = *array2bz;
+
+        size_t count = (size_t) array->blocksWide * array->blocksHigh;
+        for (size_t b = 0; b < count; b++) {
+                free(array->blocks[b].data);
+        }
+        for (int s = 0; s < array->cached; s++) {
+                free(array->slots[s].cells);
+                free(array->slots[s].clean);
+        }
+        free(array->blocks);
+        free(array->slots);
+        free(array->deltas);
+        free(array->packed);
+        free(array);
+        *array2bz = NULL;
+}
+
+/********** UArray2bz_width ********
+ *
+ * Gets the number of columns of the array
+ *
+ * Parameters:
+ *      T array2bz:     the array
+ *
+ * Return: the number of columns
+ *
+ * Notes:
+ *      - Calls CRE when array2bz is NULL
+ *
+ ************************/
+int UArray2bz_width(T array2bz)
+{
+        assert(array2bz != NULL);
+        return array2bz->width;
+}
+
+/********** UArray2bz_height ********
+ *
+ * Gets the number of rows of the array
+ *
+ * Parameters:
+ *      T array2bz:     the array
+ *
+ * Return: the number of rows
+ *
+ * Notes:
+ *      - Calls CRE when array2bz is NULL
+ *
+ ************************/
+int UArray2bz_height(T array2bz)
+{
+        assert(array2bz != NULL);
+        return array2bz->height;
+}
+
+/********** UArray2bz_size ********
+ *
+ * Gets the number of bytes in a cell of the array
+ *
+ * Parameters:
+ *      T array2bz:     the array
+ *
+ * Return: the number of bytes in a cell
+ *
+ * Notes:
+ *      - Calls CRE when array2bz is NULL
+ *
+ ************************/
+int UArray2bz_size(T array2bz)
+{
+        assert(array2bz != NULL);
+        return array2bz->size;
+}
+
+/********** UArray2bz_blocksize ********
+ *
+ * Gets the width and height of a block of the array
+ *
+ * Parameters:
+ *      T array2bz:     the array
+ *
+ * Return: the width and height of a block
+ *
+ * Notes:
+ *      - Calls CRE when array2bz is NULL
+ *
+ ************************/
+int UArray2bz_blocksize(T array2bz)
+{
+        assert(array2bz != NULL);
+        return array2bz->blocksize;
+}
+
+/********** pack ********
+ *
+ * Run length codes cells: a control byte c below LITERALS is followed by
+ * c + 1 cells to copy, any other by one cell to repeat c - LITERALS + 2
+ * times
+ *
+ * Parameters:
+ *      const char *in:         the cells
+ *      int n:                  how many there are
+ *      int size:               bytes in a cell
+ *      char *out:              where the code goes; it must have room for
+ *                              n * size bytes and a control byte per cell,
+ *                              the worst case being single cells between
+ *                              runs of two
+ *
+ * Return: the number of bytes of code
+ *
+ ************************/
+static size_t pack(const char *in, int n, int size, char *out)
+{
+        char *p = out;
+        int i = 0;
+
+        while (i < n) {
+                const char *cell = in + (size_t) i * size;
+                int run = 1;
+                while (i + run < n && run < REPEATS &&
+                       memcmp(cell + (size_t) run * size, cell, size) == 0) {
+                        run++;
+                }
+                if (run > 1) {
+                        *p++ = (char) (run - 2 + LITERALS);
+                        memcpy(p, cell, size);
+                        p += size;
+                        i += run;
+                        continue;
+                }
+
+                /* copy cells up to the start of the next run */
+                int literals = 1;
+                while (i + literals < n && literals < LITERALS &&
+                       !(i + literals + 1 < n &&
+                         memcmp(cell + (size_t) literals * size,
+                                cell + (size_t) (literals + 1) * size,
+                                size) == 0)) {
+                        literals++;
+                }
+                *p++ = (char) (literals - 1);
+                memcpy(p, cell, (size_t) literals * size);
+                p += (size_t) literals * size;
+                i += literals;
+        }
+        return p - out;
+}
+
+/********** unpack ********
+ *
+ * Decodes cells run length coded by pack
+ *
+ * Parameters:
+ *      const char *in:         the code
+ *      size_t bytes:           bytes in the code
+ *      int size:               bytes in a cell
+ *      char *out:              where the cells go
+ *
+ * Return: n/a
+ *
+ ************************/
+static void unpack(const char *in, size_t bytes, int size, char *out)
+{
+        const char *end = in + bytes;
+
+        while (in < end) {
+                int control = (unsigned char) *in++;
+                if (control < LITERALS) {
+                        size_t length = (size_t) (control + 1) * size;
+                        memcpy(out, in, length);
+                        in += length;
+                        out += length;
+                } else {
+                        for (int r = control - LITERALS + 2; r > 0; r--) {
+                                memcpy(out, in, size);
+                                out += size;
+                        }
+                        in += size;
+                }
+        }
+}
+
+/********** writeBack ********
+ *
+ * Compresses the block in a dirty slot back into the block's data
+ *
+ * Parameters:
+ *      T array:                the array
+ *      struct slot *slot:      the slot, which holds a block
+ *
+ * Return: n/a
+ *
+ * Notes:
+ *      - Calls CRE if memory cannot be allocated
+ *      - Nothing is compressed if the cells still match the clean copy
+ *      made when the block was loaded: the slot was only read
+ *      - Cells are replaced by their bytewise differences from the cell
+ *      before them first; if the code is no smaller than the cells the
+ *      cells are kept as they are
+ *
+ ************************/
+static void writeBack(T array, struct slot *slot)
+{
+        struct block *block = &array->blocks[slot->block];
+        const unsigned char *cells = (const unsigned char *) slot->cells;
+        unsigned char *deltas = (unsigned char *) array->deltas;
+        size_t bytes = array->blockBytes;
+        int size = array->size;
+
+        slot->dirty = false;
+        if (memcmp(slot->cells, slot->clean, bytes) == 0) {
+                return;
+        }
+        memcpy(slot->clean, slot->cells, bytes);
+
+        memcpy(deltas, cells, size);
+        for (size_t k = size; k < bytes; k++) {
+                deltas[k] = cells[k] - cells[k - size];
+        }
+        size_t code = pack(array->deltas, bytes / size, size, array->packed);
+
+        const char *from = array->packed;
+        block->stored = code >= bytes;
+        if (block->stored) {
+                code = bytes;
+                from = slot->cells;
+        }
+        if ((size_t) block->bytes != code || block->data == NULL) {
+                free(block->data);
+                block->data = malloc(code);
+                assert(block->data != NULL);
+        }
+        memcpy(block->data, from, code);
+        array->compressed += code;
+        array->compressed -= block->bytes;
+        block->bytes = code;
+}
+
+/********** load ********
+ *
+ * Finds the cache slot holding a block, decompressing the block into the
+ * least recently used unpinned slot if no slot holds it
+ *
+ * Parameters:
+ *      T array:                the array
+ *      int index:              the block, in row-major order of blocks
+ *
+ * Return: the slot
+ *
+ * Notes:
+ *      - Calls CRE if every slot is pinned
+ *      - The slot is marked used now and dirty, since the caller gets
+ *      pointers it may write through; a block decompressed is copied to
+ *      the slot's clean cells, so a slot only read is not compressed again
+ *
+ ************************/
+static struct slot *load(T array, int index)
+{
+        struct block *block = &array->blocks[index];
+        struct slot *slot;
+
+        if (block->slot >= 0) {
+                array->hits++;
+                slot = &array->slots[block->slot];
+        } else {
+                array->misses++;
+                slot = NULL;
+                for (int s = 0; s < array->cached; s++) {
+                        struct slot *candidate = &array->slots[s];
+                        if (candidate->pins == 0 &&
+                            (slot == NULL || candidate->used < slot->used)) {
+                                slot = candidate;
+                        }
+                }
+                assert(slot != NULL);
+
+                if (slot->block >= 0) {
+                        if (slot->dirty) {
+                                writeBack(array, slot);
+                        }
+                        array->blocks[slot->block].slot = -1;
+                }
+                slot->block = index;
+                block->slot = slot - array->slots;
+
+                unsigned char *cells = (unsigned char *) slot->cells;
+                if (block->data == NULL) {
+                        memset(cells, 0, array->blockBytes);
+                } else if (block->stored) {
+                        memcpy(cells, block->data, array->blockBytes);
+                } else {
+                        unpack(block->data, block->bytes, array->size,
+                               slot->cells);
+                        for (size_t k = array->size; k < array->blockBytes;
+                             k++) {
+                                cells[k] += cells[k - array->size];
+                        }
+                }
+                memcpy(slot->clean, cells, array->blockBytes);
+        }
+        slot->used = ++array->clock;
+        slot->dirty = true;
+        return slot;
+}
+
+/********** UArray2bz_at ********
+ *
+ * Retrieves a pointer to the cell at [column, row]
+ *
+ * Parameters:
+ *      T       array2bz:       the array
+ *      int     column:         the column of the cell
+ *      int     row:            the row of the cell
+ *
+ * Return: a pointer to the cell in its decompressed block
+ *
+ * Expects: array2bz to not be NULL and column and row to be in range
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - The pointer is only good until the next UArray2bz_at on the same
+ *      array, which may evict its block; pointers handed to the apply
+ *      function of UArray2bz_map stay good for the whole call
+ *
+ ************************/
+void *UArray2bz_at(T array2bz, int column, int row)
+{
+        assert(array2bz != NULL);
+        assert(column >= 0 && column < array2bz->width);
+        assert(row >= 0 && row < array2bz->height);
+        int blocksize = array2bz->blocksize;
+
+        struct slot *slot = load(array2bz, (row / blocksize) *
+                                           array2bz->blocksWide +
+                                           column / blocksize);
+        return slot->cells + ((size_t) blocksize * (column % blocksize) +
+                              row % blocksize) * array2bz->size;
+}
+
+/********** UArray2bz_map ********
+ *
+ * Iterates through the array block by block, visiting every cell of a block
+ * before moving to the next block
+ *
+ * Parameters:
+ *      T       array2bz:       the array
+ *      void (*apply):          the function called on each cell with its
+ *                              column, row, the array, a pointer to the cell
+ *                              and cl
+ *      void *cl:               the closure passed to apply
+ *
+ * Return: n/a
+ *
+ * Expects: array2bz and apply to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Blocks are visited in row-major order and cells within a block in
+ *      the same order as UArray2b_map; the block being visited is pinned in
+ *      the cache, so apply may call UArray2bz_at on the same array
+ *
+ ************************/
+void UArray2bz_map(T array2bz,
+                   void apply(int col, int row, T array2bz, void *elem,
+                              void *cl),
+                   void *cl)
+{
+        assert(array2bz != NULL);
+        assert(apply != NULL);
+        int blocksize = array2bz->blocksize;
+        int size = array2bz->size;
+        int cells = blocksize * blocksize;
+
+        for (int by = 0; by < array2bz->blocksHigh; by++) {
+                for (int bx = 0; bx < array2bz->blocksWide; bx++) {
+                        struct slot *slot = load(array2bz,
+                                             by * array2bz->blocksWide + bx);
+                        slot->pins++;
+                        for (int i = 0; i < cells; i++) {
+                                int col = bx * blocksize + i / blocksize;
+                                int row = by * blocksize + i % blocksize;
+                                if (col < array2bz->width &&
+                                    row < array2bz->height) {
+                                        apply(col, row, array2bz,
+                                              slot->cells + (size_t) i * size,
+                                              cl);
+                                }
+                        }
+                        slot->pins--;
+                        slot->dirty = true;
+                }
+        }
+}
+
+/********** UArray2bz_print ********
+ *
+ * Prints how small the array's blocks are compressed and how often its
+ * cache held the block asked for
+ *
+ * Parameters:
+ *      T       array2bz:       the array
+ *      FILE    *fp:            where the report goes
+ *
+ * Return: n/a
+ *
+ * Expects: array2bz and fp to not be NULL
+ *
+ * Notes:
+ *      - Calls CRE if any of the expectations are violated
+ *      - Dirty cached blocks are compressed first so the sizes are current;
+ *      they stay cached. Blocks never written count as empty.
+ *
+ ************************/
+void UArray2bz_print(T array2bz, FILE *fp)
+{
+        assert(array2bz != NULL && fp != NULL);
+
+        for (int s = 0; s < array2bz->cached; s++) {
+                struct slot *slot = &array2bz->slots[s];
+                if (slot->block >= 0 && slot->dirty) {
+                        writeBack(array2bz, slot);
+                }
+        }
+        size_t raw = array2bz->blockBytes * array2bz->blocksWide *
+                     array2bz->blocksHigh;
+        size_t cache = array2bz->blockBytes * array2bz->cached;
+        unsigned long uses = array2bz->hits + array2bz->misses;
+
+        fprintf(fp, "blocks: %zu bytes compressed from %zu (%.1fx), "
+                    "%zu more cached\n", array2bz->compressed, raw,
+                array2bz->compressed > 0 ? (double) raw /
+                                           array2bz->compressed : 0.0,
+                cache);
+        fprintf(fp, "cache: %d blocks, %lu hits, %lu misses (%.1f%% hit "
+                    "rate)\n", array2bz->cached, array2bz->hits,
+                array2bz->misses,
+                uses > 0 ? 100.0 * array2bz->hits / uses : 0.0);
+}
+
+#undef T
@@ -0,0 +1,58 @@
+/**************************************************************
+ *
+ *                     uarray2bz.h
+ *
+ *     Assignment: locality
+ *     Authors:  Lawer Nyako (lnyako01) & Rigoberto Rodriguez-Anton (rrodri08)
+ *     Date:    10-19-26
+ *
+ *     Summary: The interface for a blocked 2D array that keeps its blocks
+ *              compressed. Blocks are laid out as in UArray2b; the ones in
+ *              use are decompressed into a small cache of recently used
+ *              blocks, and compressed again when they leave it.
+ *
+ **************************************************************/
+
+#ifndef UARRAY2BZ_INCLUDED
+#define UARRAY2BZ_INCLUDED
+
+#include <stdio.h>
+
+#define T UArray2bz_T
+typedef struct T *T;
+
+/* new compressed blocked 2d array of zeroed cells: blocksize = square root
+ * of # of cells in block, cached = # of blocks kept decompressed (at least
+ * 2) */
+extern T     UArray2bz_new(int width, int height, int size, int blocksize,
+                           int cached);
+
+/* as above with blocks of at most 64KB, as UArray2b_new_64K_block */
+extern T     UArray2bz_new_64K_block(int width, int height, int size,
+                                     int cached);
+
+extern void  UArray2bz_free     (T *array2bz);
+
+extern int   UArray2bz_width    (T  array2bz);
+extern int   UArray2bz_height   (T  array2bz);
+extern int   UArray2bz_size     (T  array2bz);
+extern int   UArray2bz_blocksize(T  array2bz);
+
+/* return a pointer to the cell in the given column and row, valid until the
+ * next call of UArray2bz_at on the same array; index out of range is a
+ * checked run-time error
+ */
+extern void *UArray2bz_at(T array2bz, int column, int row);
+
+/* visits every cell in one block before moving to another block, with only
+ * the block being visited decompressed for the traversal */
+extern void  UArray2bz_map(T array2bz,
+                           void apply(int col, int row, T array2bz,
+                                      void *elem, void *cl),
+                           void *cl);
+
+/* print the compressed and uncompressed sizes and the cache hit rate */
+extern void  UArray2bz_print(T array2bz, FILE *fp);
+
+#undef T
+#endif